@@ -1,8 +1,53 @@
 #ifndef __COMMON_H__
+  #define __COMMON_H__
+
   #include "contiki.h"
 
-  #define UDP_CLIENT_PORT 8765
-  #define UDP_SERVER_PORT 5678
+  /* Transport profiles. The compressed one uses ports in 0xf0b0-0xf0bf, which
+   * 6LoWPAN NHC carries in one byte instead of four. The legacy one keeps the
+   * old ports for hosts that expect them.
+   *
+   * Contiki 2.7's RPL puts its hop-by-hop option into every datagram a mote
+   * originates (rpl_insert_header() in the UDP output path, there is no
+   * switch for it). sicslowpan only compresses a UDP header that directly
+   * follows the IPv6 header, so with RPL the ports go uncompressed in both
+   * profiles and the choice makes no difference on air. Skipping the option
+   * for traffic to the root needs a change to core/net/rpl; the ports are
+   * kept so that such a build, or one on a later Contiki that has
+   * RPL_CONF_INSERT_HBH_OPTION, saves the 3 bytes without another flag day. */
+  #define SENSOR_TRANSPORT_LEGACY     0
+  #define SENSOR_TRANSPORT_COMPRESSED 1
+
+  #ifndef SENSOR_CONF_TRANSPORT
+    #define SENSOR_TRANSPORT SENSOR_TRANSPORT_COMPRESSED
+  #else
+    #define SENSOR_TRANSPORT SENSOR_CONF_TRANSPORT
+  #endif
+
+  #if SENSOR_TRANSPORT == SENSOR_TRANSPORT_COMPRESSED
+    #define UDP_CLIENT_PORT 0xf0b1
+    #define UDP_SERVER_PORT 0xf0b0
+  #else
+    #define UDP_CLIENT_PORT 8765
+    #define UDP_SERVER_PORT 5678
+  #endif
+
+  /* Room for the 6LoWPAN packet in one 802.15.4 frame, as sicslowpan counts it
+   * (MAC_MAX_PAYLOAD) */
+  #define LOWPAN_FRAME_ROOM 102
+
+  /* IPv6 and UDP headers as sent, uncompressed and worst case compressed. The
+   * worst case is a datagram forwarded by another mote, so neither interface
+   * id follows from the MAC addresses and the decremented hop limit (63) is
+   * carried inline, with the RPL hop-by-hop option that keeps the UDP header
+   * uncompressed: IPHC 2 + next header 1 + hop limit 1 + source and
+   * destination interface ids 16 + hop-by-hop 8 + UDP 8. A mote one hop from
+   * the root needs 19 bytes (IPHC 2 + next header 1 + hop-by-hop 8 + UDP 8). */
+  #define LOWPAN_HDR_UNCOMPRESSED (40 + 8 + 8)   /* with the hop-by-hop option */
+  #define LOWPAN_HDR_WORST        36
+
+  /* Longest datagram payload that is never fragmented */
+  #define SENSOR_FRAME_MAX_LEN (LOWPAN_FRAME_ROOM - LOWPAN_HDR_WORST)
 
   typedef struct {
     int16_t tempint;
@@ -10,11 +55,40 @@
     char minus;
   } temp_t;
 
+  /* Temperature and light of one node, as logged and served by the border router */
   typedef struct {
     temp_t temperature;
     uint16_t light_intensity;
   } sensor_packet;
 
+  /* Every datagram from a mote starts with a frame type. A sample frame carries
+   * the readings taken in one send period. A batch frame carries a count byte
+   * followed by that many backlog entries, oldest first, each made of the age
+   * in seconds (16 bit little endian), the length of its readings and the
+   * readings themselves. */
+  #define SENSOR_FRAME_SAMPLE 'S'
+  #define SENSOR_FRAME_BATCH  'B'
+
+  #define SENSOR_BATCH_ENTRY_HDR_LEN 3
+
+  /* Readings are encoded as <sensor id> <value length> <value>, multi-byte
+   * values are little endian */
+  #define SENSOR_ID_TEMPERATURE 1   /* int16_t, 1/16 degree Celsius */
+  #define SENSOR_ID_LIGHT       2   /* uint16_t, raw light sensor value */
+  #define SENSOR_ID_ACCEL       3   /* 3 x int16_t, x/y/z raw accelerometer */
+  #define SENSOR_ID_BATTERY     4   /* uint16_t, millivolts */
+  #define SENSOR_ID_ADC         5   /* 2 x uint16_t, raw external ADC channels */
+  #define SENSOR_ID_LINK        6   /* int8_t TX power in dBm, uint8_t parent PRR in % */
+  #define SENSOR_ID_SEQ         7   /* uint16_t sample count since boot, uint16_t boot number
+                                     * (never 0); older motes send the count alone */
+
+  #define SENSOR_READING_HDR_LEN  2
+  #define SENSOR_READINGS_MAX_LEN 40
+
+  #if 1 + SENSOR_READINGS_MAX_LEN > SENSOR_FRAME_MAX_LEN
+    #error "A sample frame does not fit in one 802.15.4 frame"
+  #endif
+
   #define DEBUG_ENABLED 1
   #define DEBUG DEBUG_PRINT
   #include "net/uip-debug.h"
@@ -0,0 +1,16 @@
+#ifndef __LOWPAN_CONF_H__
+  #define __LOWPAN_CONF_H__
+
+  /* 6LoWPAN settings that the motes and the border router must agree on,
+   * included from both project-conf.h files */
+
+  /* The DAG prefix, as passed to tunslip6 (PREFIX in the border router's
+   * Makefile). It has to match HC06 context 0, which Contiki's Z1
+   * configuration already sets to aaaa::, so that addresses inside the mesh
+   * only carry their interface id, or nothing when it follows from the MAC.
+   * The host may hand out another prefix, header compression then falls back
+   * to carrying it inline. */
+  #define SENSOR_NET_PREFIX 0xaa, 0xaa, 0, 0, 0, 0, 0, 0
+
+  #define SICSLOWPAN_CONF_COMPRESSION SICSLOWPAN_COMPRESSION_HC06
+#endif
@@ -0,0 +1,205 @@
+/**
+ * \file
+ *         Streaming anomaly filter for the readings forwarded to the host
+ */
+
+#include "contiki.h"
+
+#include <string.h>
+
+#include "anomaly-filter.h"
+
+/* EWMA weight of a new sample is 1/2^EWMA_SHIFT */
+#define EWMA_SHIFT  3
+/* Fractional bits of the stored means */
+#define MEAN_SHIFT  4
+/* Samples needed before the variance is trusted */
+#define WARMUP      8
+/* Keeps squared deviations within 32 bits */
+#define MAX_DIFF    0x7fff
+
+#define DEFAULT_SIGMA            3
+#define DEFAULT_TEMP_MIN_DEV     8     /* 0.5 degC */
+#define DEFAULT_TEMP_MAX_STEP    32    /* 2 degC */
+#define DEFAULT_LIGHT_MIN_DEV    20
+#define DEFAULT_LIGHT_MAX_STEP   400
+#define DEFAULT_SUMMARY_INTERVAL 300
+
+typedef struct {
+  int32_t mean;       /* scaled by 2^MEAN_SHIFT */
+  int32_t var;
+  int32_t last;
+  int32_t sum;
+} channel;
+
+typedef struct {
+  uint8_t node_id;
+  uint8_t samples;    /* saturates at WARMUP */
+  uint8_t anomalous;
+  uint16_t count;     /* samples since the last summary */
+  uint32_t last_summary;
+  channel temp;
+  channel light;
+} node_model;
+
+static node_model models[ANOMALY_FILTER_NODES];
+static uint32_t suppressed;
+
+static anomaly_config config = {
+  DEFAULT_SIGMA,
+  DEFAULT_TEMP_MIN_DEV,
+  DEFAULT_TEMP_MAX_STEP,
+  DEFAULT_LIGHT_MIN_DEV,
+  DEFAULT_LIGHT_MAX_STEP,
+  DEFAULT_SUMMARY_INTERVAL
+};
+
+static node_model *model_for(uint8_t node_id) {
+  int i;
+
+  if (node_id == 0) {
+    return NULL;
+  }
+
+  for (i = 0; i < ANOMALY_FILTER_NODES; ++i) {
+    if (models[i].node_id == node_id) {
+      return &models[i];
+    }
+  }
+
+  for (i = 0; i < ANOMALY_FILTER_NODES; ++i) {
+    if (models[i].node_id == 0) {
+      memset(&models[i], 0, sizeof(node_model));
+      models[i].node_id = node_id;
+      models[i].last_summary = clock_seconds();
+      return &models[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Updates one channel and returns 1 if x is anomalous against the model as
+ * it was before x */
+static int update_channel(channel *c, int32_t x, uint8_t samples, uint16_t min_dev, uint16_t max_step) {
+  int32_t diff;
+  int32_t step;
+  uint32_t bound;
+  int anomalous;
+
+  if (samples == 0) {
+    c->mean = x * (1 << MEAN_SHIFT);
+    c->var = 0;
+    c->last = x;
+    c->sum = x;
+    return 0;
+  }
+
+  diff = x - (c->mean >> MEAN_SHIFT);
+  if (diff > MAX_DIFF) {
+    diff = MAX_DIFF;
+  } else if (diff < -MAX_DIFF) {
+    diff = -MAX_DIFF;
+  }
+  step = x - c->last;
+
+  anomalous = step > max_step || -step > max_step;
+  if (samples >= WARMUP && config.sigma > 0) {
+    /* Unsigned, min_dev may take the whole 16 bit range. var is never
+     * negative. */
+    bound = (uint32_t)min_dev * min_dev;
+    if ((uint32_t)c->var > bound) {
+      bound = c->var;
+    }
+    /* diff^2 > sigma^2 * var, divided to stay within 32 bits */
+    anomalous |= (uint32_t)(diff * diff) / ((uint32_t)config.sigma * config.sigma) > bound;
+  }
+
+  c->mean += (x * (1 << MEAN_SHIFT) - c->mean) >> EWMA_SHIFT;
+  c->var += (diff * diff - c->var) >> EWMA_SHIFT;
+  c->last = x;
+  c->sum += x;
+
+  return anomalous;
+}
+
+int anomaly_filter_sample(uint8_t node_id, int16_t temperature, uint16_t light, uint8_t *flags) {
+  node_model *m;
+  int anomalous;
+
+  *flags = 0;
+  m = model_for(node_id);
+  if (m == NULL) {
+    return 1;
+  }
+
+  if (m->count == 0) {
+    m->temp.sum = 0;
+    m->light.sum = 0;
+  }
+  anomalous = update_channel(&m->temp, temperature, m->samples,
+                             config.temp_min_dev, config.temp_max_step);
+  anomalous |= update_channel(&m->light, light, m->samples,
+                              config.light_min_dev, config.light_max_step);
+  ++m->count;
+
+  /* The first sample of a node is forwarded as its transition into the
+   * normal state */
+  if (m->samples == 0) {
+    *flags = ANOMALY_FLAG_TRANSITION;
+  }
+  if (m->samples < WARMUP) {
+    ++m->samples;
+  }
+
+  if (anomalous) {
+    *flags |= ANOMALY_FLAG_ANOMALY;
+  }
+  if (anomalous != m->anomalous) {
+    m->anomalous = anomalous;
+    *flags |= ANOMALY_FLAG_TRANSITION;
+  }
+
+  if (config.sigma == 0) {
+    /* Everything goes out, there is nothing to summarize */
+    m->count = 0;
+    return 1;
+  }
+  if (*flags != 0) {
+    return 1;
+  }
+
+  ++suppressed;
+  return 0;
+}
+
+int anomaly_filter_summary(uint8_t node_id, int16_t *temperature, uint16_t *light) {
+  node_model *m;
+  uint32_t now;
+
+  m = model_for(node_id);
+  now = clock_seconds();
+  if (m == NULL || m->count == 0 || now - m->last_summary < config.summary_interval) {
+    return 0;
+  }
+
+  *temperature = m->temp.sum / m->count;
+  *light = m->light.sum / m->count;
+  m->count = 0;
+  m->last_summary = now;
+
+  return 1;
+}
+
+void anomaly_filter_get_config(anomaly_config *c) {
+  memcpy(c, &config, sizeof(anomaly_config));
+}
+
+/* Models are kept, the new thresholds apply from the next sample on */
+void anomaly_filter_set_config(const anomaly_config *c) {
+  memcpy(&config, c, sizeof(anomaly_config));
+}
+
+uint32_t anomaly_filter_suppressed(void) {
+  return suppressed;
+}
@@ -0,0 +1,55 @@
+/**
+ * \file
+ *         Streaming anomaly filter for the readings forwarded to the host
+ *
+ *         Each node's temperature and light are tracked with an integer
+ *         exponentially weighted mean and variance. A sample is anomalous
+ *         when it deviates from the mean by more than sigma standard
+ *         deviations, or when it changed by more than the step limit since
+ *         the node's previous sample. Only anomalous samples and the samples
+ *         where a node enters or leaves the anomalous state are forwarded at
+ *         full resolution; in between the host gets the average of each node
+ *         once per summary interval.
+ */
+
+#ifndef __ANOMALY_FILTER_H__
+#define __ANOMALY_FILTER_H__
+
+#include "contiki.h"
+
+#ifndef ANOMALY_FILTER_CONF_NODES
+#define ANOMALY_FILTER_NODES 8
+#else /* ANOMALY_FILTER_CONF_NODES */
+#define ANOMALY_FILTER_NODES ANOMALY_FILTER_CONF_NODES
+#endif /* ANOMALY_FILTER_CONF_NODES */
+
+/* Flags of a forwarded record */
+#define ANOMALY_FLAG_ANOMALY    0x01
+#define ANOMALY_FLAG_TRANSITION 0x02
+#define ANOMALY_FLAG_SUMMARY    0x04
+
+typedef struct {
+  uint8_t sigma;             /* 0 forwards every sample */
+  uint16_t temp_min_dev;     /* 1/16 degC, lower bound of the standard deviation */
+  uint16_t temp_max_step;    /* 1/16 degC */
+  uint16_t light_min_dev;
+  uint16_t light_max_step;
+  uint16_t summary_interval; /* seconds */
+} anomaly_config;
+
+void anomaly_filter_get_config(anomaly_config *config);
+void anomaly_filter_set_config(const anomaly_config *config);
+
+/* Feeds a sample into the node's model. Returns 1 and sets the record flags
+ * if the sample should be forwarded. Nodes beyond the table are forwarded
+ * unfiltered with no flags. */
+int anomaly_filter_sample(uint8_t node_id, int16_t temperature, uint16_t light, uint8_t *flags);
+
+/* Returns 1 with the node's averages since the last summary when a summary
+ * is due */
+int anomaly_filter_summary(uint8_t node_id, int16_t *temperature, uint16_t *light);
+
+/* Samples held back since boot */
+uint32_t anomaly_filter_suppressed(void);
+
+#endif /* __ANOMALY_FILTER_H__ */
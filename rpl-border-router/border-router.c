@@ -55,16 +55,45 @@
 #define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 
 #include "httpd-simple.h"
+#include "anomaly-filter.h"
+#include "border-router.h"
+#include "coap-server.h"
+#include "prefix-store.h"
+#include "profiler.h"
+#include "record-log.h"
+#include "rollup.h"
 #include "common.h"
 
+/* Prefix request backoff: fast while the mesh is dark on first boot, slow when
+ * a stored prefix already lets us serve as DAG root. Without a stored prefix
+ * the router cannot do anything until the host answers, so it keeps asking
+ * every few seconds however late tunslip6 comes up. */
+#define PREFIX_REQUEST_FIRST_BOOT     (CLOCK_SECOND / 8)
+#define PREFIX_REQUEST_FIRST_BOOT_MAX (CLOCK_SECOND * 2)
+#define PREFIX_REQUEST_RECONCILE      CLOCK_SECOND
+#define PREFIX_REQUEST_MAX_INTERVAL   (CLOCK_SECOND * 64)
+
+/* clock_time_t is 16 bit on the Z1 (CLOCK_SECOND 128), so the longest
+ * interval is a little under 512 s there */
+typedef char prefix_request_interval_fits[
+  sizeof(clock_time_t) > 2 || PREFIX_REQUEST_MAX_INTERVAL <= 0xffff ? 1 : -1];
+
 static uip_ip6addr_t local_address = { 0x1111, 0x1100, 0, 0, 0, 0, 0, 0x0011 };
 static struct uip_udp_conn *udp_connection;
 static uip_ipaddr_t prefix;
 static uint8_t prefix_set;
+static uip_ipaddr_t host_prefix;
+static uint8_t host_prefix_received;
+static uint8_t first_reading_seen;
 
 PROCESS(border_router_process, "Border router process");
 PROCESS(webserver_nogui_process, "Web server");
-AUTOSTART_PROCESSES(&border_router_process, &webserver_nogui_process);
+#if WITH_COAP
+AUTOSTART_PROCESSES(&border_router_process, &webserver_nogui_process, &record_log_process,
+                    &coap_server_process);
+#else /* WITH_COAP */
+AUTOSTART_PROCESSES(&border_router_process, &webserver_nogui_process, &record_log_process);
+#endif /* WITH_COAP */
 PROCESS_THREAD(webserver_nogui_process, ev, data) {
   PROCESS_BEGIN();
 
@@ -78,19 +107,18 @@ PROCESS_THREAD(webserver_nogui_process, ev, data) {
   PROCESS_END();
 }
 
-typedef struct {
-  uint8_t node_id;
-  temp_t temperature;
-  uint16_t light_intensity;
-} sensor_measurement;
-
 static const char *TOP = "<html><head><title>ContikiRPL</title></head><body>\n";
 static const char *BOTTOM = "</body></html>\n";
-static sensor_measurement sensor_measurements[] = {
-  { 0, 0, 0},
-  { 0, 0, 0},
-  { 0, 0, 0}
-};
+sensor_measurement sensor_measurements[MAX_SENSOR_NODES];
+
+/* Interface ids of the nodes heard so far, a node's id on the router is its
+ * index here plus one. Z1 motes derive their address from their own node id,
+ * so the last address byte repeats every 256 motes and cannot key the
+ * tables. */
+static uint8_t node_iids[BORDER_ROUTER_NODES][8];
+static uint8_t node_count;
+
+static void temp_from_sixteenths(temp_t *temp, int16_t sixteenths);
 
 static PT_THREAD(generate_sensor_html(struct httpd_state *s)) {
   static int i;
@@ -108,11 +136,16 @@ static PT_THREAD(generate_sensor_html(struct httpd_state *s)) {
   SEND_STRING(&s->sout, "Light intensity");
   SEND_STRING(&s->sout, "</li>");
 
-  for (i = 0; i < 3; ++i) {
+  for (i = 0; i < MAX_SENSOR_NODES; ++i) {
     if (sensor_measurements[i].node_id != 0) {
       SEND_STRING(&s->sout, "<li>");
 
-      sprintf(str_buf, "%u", sensor_measurements[i].node_id);
+      /* The id with the end of the interface id it stands for */
+      sprintf(str_buf, "%u (%x:%x)", sensor_measurements[i].node_id,
+        (node_iids[sensor_measurements[i].node_id - 1][4] << 8) |
+          node_iids[sensor_measurements[i].node_id - 1][5],
+        (node_iids[sensor_measurements[i].node_id - 1][6] << 8) |
+          node_iids[sensor_measurements[i].node_id - 1][7]);
       SEND_STRING(&s->sout, str_buf);
       SEND_STRING(&s->sout, " - ");
 
@@ -126,16 +159,196 @@ static PT_THREAD(generate_sensor_html(struct httpd_state *s)) {
       sprintf(str_buf, "%u", sensor_measurements[i].light_intensity);
       SEND_STRING(&s->sout, str_buf);
 
+      if (sensor_measurements[i].present & SENSOR_PRESENT(SENSOR_ID_BATTERY)) {
+        sprintf(str_buf, " - %u mV", sensor_measurements[i].battery_mv);
+        SEND_STRING(&s->sout, str_buf);
+      }
+
+      if (sensor_measurements[i].present & SENSOR_PRESENT(SENSOR_ID_ACCEL)) {
+        sprintf(str_buf, " - accel %d", sensor_measurements[i].accel[0]);
+        SEND_STRING(&s->sout, str_buf);
+        sprintf(str_buf, "/%d", sensor_measurements[i].accel[1]);
+        SEND_STRING(&s->sout, str_buf);
+        sprintf(str_buf, "/%d", sensor_measurements[i].accel[2]);
+        SEND_STRING(&s->sout, str_buf);
+      }
+
+      if (sensor_measurements[i].present & SENSOR_PRESENT(SENSOR_ID_ADC)) {
+        sprintf(str_buf, " - adc %u", sensor_measurements[i].adc[0]);
+        SEND_STRING(&s->sout, str_buf);
+        sprintf(str_buf, "/%u", sensor_measurements[i].adc[1]);
+        SEND_STRING(&s->sout, str_buf);
+      }
+
+      if (sensor_measurements[i].present & SENSOR_PRESENT(SENSOR_ID_LINK)) {
+        sprintf(str_buf, " - tx %d dBm", sensor_measurements[i].tx_power);
+        SEND_STRING(&s->sout, str_buf);
+        if (sensor_measurements[i].link_prr <= 100) {
+          sprintf(str_buf, ", prr %u%%", sensor_measurements[i].link_prr);
+          SEND_STRING(&s->sout, str_buf);
+        }
+      }
+
       SEND_STRING(&s->sout, "</li>");
     }
   }
 
+  SEND_STRING(&s->sout, "</ul><p>Host link ");
+  SEND_STRING(&s->sout, (record_log_host_up() ? "up" : "down"));
+  SEND_STRING(&s->sout, ", buffered records: ");
+  sprintf(str_buf, "%lu", (unsigned long)record_log_pending());
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, ", evicted: ");
+  sprintf(str_buf, "%lu", (unsigned long)record_log_evicted());
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, ", held back as unremarkable: ");
+  sprintf(str_buf, "%lu", (unsigned long)anomaly_filter_suppressed());
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, "</p>");
+
+  SEND_STRING(&s->sout, BOTTOM);
+
+  PSOCK_END(&s->sout);
+}
+
+/* Serves /min, /hour and /day: the last complete and the current bucket of
+ * every node, temperatures as avg/min/max */
+static PT_THREAD(generate_rollup_html(struct httpd_state *s)) {
+  static rollup_bucket buckets[2];
+  static uint8_t resolution;
+  static int i;
+  static int j;
+  static temp_t temp;
+  char str_buf[24];
+
+  PSOCK_BEGIN(&s->sout);
+
+  resolution = s->filename[1] == 'm' ? ROLLUP_MINUTE : (s->filename[1] == 'h' ? ROLLUP_HOUR : ROLLUP_DAY);
+
+  SEND_STRING(&s->sout, TOP);
+  SEND_STRING(&s->sout, "<p>Period ");
+  sprintf(str_buf, "%lu", (unsigned long)rollup_period(resolution));
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, " s</p>");
+  SEND_STRING(&s->sout, "<ul><li>Node - start - samples - temperature - light</li>");
+
+  for (i = 0; i < MAX_SENSOR_NODES; ++i) {
+    if (sensor_measurements[i].node_id == 0 ||
+        !rollup_get(sensor_measurements[i].node_id, resolution, &buckets[1], &buckets[0])) {
+      continue;
+    }
+
+    for (j = 0; j < 2; ++j) {
+      if (buckets[j].count == 0) {
+        continue;
+      }
+
+      sprintf(str_buf, "<li>%u", sensor_measurements[i].node_id);
+      SEND_STRING(&s->sout, str_buf);
+      sprintf(str_buf, " - %lu", (unsigned long)buckets[j].start);
+      SEND_STRING(&s->sout, str_buf);
+      sprintf(str_buf, " - %u - ", buckets[j].count);
+      SEND_STRING(&s->sout, str_buf);
+
+      temp_from_sixteenths(&temp, buckets[j].temp_sum / buckets[j].count);
+      sprintf(str_buf, "%c%d.%04d/", temp.minus, temp.tempint, temp.tempfrac);
+      SEND_STRING(&s->sout, str_buf);
+      temp_from_sixteenths(&temp, buckets[j].temp_min);
+      sprintf(str_buf, "%c%d.%04d/", temp.minus, temp.tempint, temp.tempfrac);
+      SEND_STRING(&s->sout, str_buf);
+      temp_from_sixteenths(&temp, buckets[j].temp_max);
+      sprintf(str_buf, "%c%d.%04d - ", temp.minus, temp.tempint, temp.tempfrac);
+      SEND_STRING(&s->sout, str_buf);
+
+      sprintf(str_buf, "%lu/", (unsigned long)(buckets[j].light_sum / buckets[j].count));
+      SEND_STRING(&s->sout, str_buf);
+      sprintf(str_buf, "%u/%u</li>", buckets[j].light_min, buckets[j].light_max);
+      SEND_STRING(&s->sout, str_buf);
+    }
+  }
+
+  SEND_STRING(&s->sout, "</ul>");
+  SEND_STRING(&s->sout, BOTTOM);
+
+  PSOCK_END(&s->sout);
+}
+
+#if WITH_PROFILER
+/* Buffer drop counters of the SLIP driver */
+extern uint16_t slip_overflow, slip_ip_drop;
+
+/* The longest string any page sends in one piece */
+#define STATS_HEADER "<ul><li>Process - dispatches - total ticks - max ticks - long</li>"
+#if HTTPD_SHARED_RESPONSE
+typedef char stats_header_fits[sizeof(STATS_HEADER) - 1 <= HTTPD_SHARED_STRING_MAX ? 1 : -1];
+#endif /* HTTPD_SHARED_RESPONSE */
+
+static PT_THREAD(generate_stats_html(struct httpd_state *s)) {
+  static const profiler_stats *stats;
+  static int i;
+  char str_buf[24];
+
+  PSOCK_BEGIN(&s->sout);
+
+  SEND_STRING(&s->sout, TOP);
+  SEND_STRING(&s->sout, STATS_HEADER);
+
+  for (i = 0; (stats = profiler_get(i)) != NULL; ++i) {
+    SEND_STRING(&s->sout, "<li>");
+    SEND_STRING(&s->sout, PROCESS_NAME_STRING(stats->p));
+    sprintf(str_buf, " - %lu", (unsigned long)stats->dispatches);
+    SEND_STRING(&s->sout, str_buf);
+    sprintf(str_buf, " - %lu", (unsigned long)stats->total);
+    SEND_STRING(&s->sout, str_buf);
+    sprintf(str_buf, " - %lu", (unsigned long)stats->max);
+    SEND_STRING(&s->sout, str_buf);
+    sprintf(str_buf, " - %u</li>", stats->long_dispatches);
+    SEND_STRING(&s->sout, str_buf);
+  }
+
+  SEND_STRING(&s->sout, "</ul><p>");
+  sprintf(str_buf, "%u", RTIMER_SECOND);
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, " ticks/s, unprofiled: ");
+  sprintf(str_buf, "%u", profiler_untracked());
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, "</p><p>Event queue peak: ");
+  sprintf(str_buf, "%u/%u", profiler_event_queue_peak(), PROCESS_CONF_NUMEVENTS);
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, "</p><p>MAC drops: ");
+  sprintf(str_buf, "%u", profiler_mac_drops());
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, ", SLIP overflows: ");
+  sprintf(str_buf, "%u", slip_overflow);
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, ", SLIP drops: ");
+  sprintf(str_buf, "%u", slip_ip_drop);
+  SEND_STRING(&s->sout, str_buf);
+#if UIP_STATISTICS
+  SEND_STRING(&s->sout, ", IP drops: ");
+  sprintf(str_buf, "%u", uip_stat.ip.drop);
+  SEND_STRING(&s->sout, str_buf);
+#endif /* UIP_STATISTICS */
+  SEND_STRING(&s->sout, ", evicted records: ");
+  sprintf(str_buf, "%lu", (unsigned long)record_log_evicted());
+  SEND_STRING(&s->sout, str_buf);
+  SEND_STRING(&s->sout, "</p>");
+
   SEND_STRING(&s->sout, BOTTOM);
 
   PSOCK_END(&s->sout);
 }
+#endif /* WITH_PROFILER */
 
 httpd_simple_script_t httpd_simple_get_script(const char *name) {
+  if (strcmp(name, "min") == 0 || strcmp(name, "hour") == 0 || strcmp(name, "day") == 0) {
+    return generate_rollup_html;
+  }
+#if WITH_PROFILER
+  if (strcmp(name, "stats") == 0) {
+    return generate_stats_html;
+  }
+#endif /* WITH_PROFILER */
   return generate_sensor_html;
 }
 
@@ -164,63 +377,319 @@ void request_prefix(void) {
   uip_len = 0;
 }
 
+/* Called from the SLIP input callback, the prefix is applied by border_router_process */
 void set_prefix_64(uip_ipaddr_t *prefix_64) {
+  memcpy(&host_prefix, prefix_64, 16);
+  host_prefix_received = 1;
+  process_poll(&border_router_process);
+}
+
+static void use_prefix(uip_ipaddr_t *prefix_64) {
+  static const uint8_t context_prefix[] = { SENSOR_NET_PREFIX };
+  uip_ds6_addr_t *old_address;
+
+  if (memcmp(prefix_64, context_prefix, sizeof(context_prefix)) != 0) {
+    printf("Prefix differs from SENSOR_NET_PREFIX, mesh headers will carry it inline\n");
+  }
+
+  if (prefix_set) {
+    old_address = uip_ds6_addr_lookup(&local_address);
+    if (old_address != NULL) {
+      uip_ds6_addr_rm(old_address);
+    }
+  }
+
   memcpy(&prefix, prefix_64, 16);
   memcpy(&local_address, prefix_64, 16);
   prefix_set = 1;
   uip_ds6_set_addr_iid(&local_address, &uip_lladdr);
   uip_ds6_addr_add(&local_address, 0, ADDR_AUTOCONF);
+  record_log_set_prefix(&prefix);
 }
 
-static void handle_sensor_packet(void) {
-  uint8_t node_id;
-  sensor_packet *data;
+static void create_dag(void) {
+  rpl_dag_t *dag;
+  prefix_config config;
 
-  if (uip_newdata()) {
-    data = (sensor_packet *)uip_appdata;
-    node_id = UIP_IP_BUF->srcipaddr.u8[sizeof(UIP_IP_BUF->srcipaddr.u8) - 1];
-
-    PRINTF("Data recv; temp: %c%d.%04d; light: %u\n",
-      data->temperature.minus,
-      data->temperature.tempint,
-      data->temperature.tempfrac,
-      data->light_intensity
-    );
-    PRINTF("From: %d\n", node_id);
-
-    int i;
-    int node_found = 0;
-    for (i = 0; i < 3; ++i) {
-      if (sensor_measurements[i].node_id == node_id) {
-        sensor_measurements[i].temperature.minus = data->temperature.minus;
-        sensor_measurements[i].temperature.tempint = data->temperature.tempint;
-        sensor_measurements[i].temperature.tempfrac = data->temperature.tempfrac;
-        sensor_measurements[i].light_intensity = data->light_intensity;
-
-        node_found = 1;
+  dag = rpl_set_root(BORDER_ROUTER_INSTANCE_ID, &local_address);
+  if(dag != NULL) {
+    rpl_set_prefix(dag, &prefix, 64);
+    PRINTF("created a new RPL dag\n");
+  }
+
+  memcpy(&config.prefix, &prefix, 16);
+  config.prefix_len = 64;
+  config.instance_id = BORDER_ROUTER_INSTANCE_ID;
+  prefix_store_save(&config);
+}
+
+static clock_time_t next_request_interval(clock_time_t interval, clock_time_t max) {
+  return interval < max / 2 ? interval * 2 : max;
+}
+
+static int load_stored_prefix(void) {
+  prefix_config config;
+
+  if (!prefix_store_load(&config) || config.instance_id != BORDER_ROUTER_INSTANCE_ID) {
+    return 0;
+  }
+
+  PRINTF("Using stored prefix ");
+  PRINT6ADDR(&config.prefix);
+  PRINTF("\n");
+  use_prefix(&config.prefix);
+
+  return 1;
+}
+
+/* Applies the prefix received from the host, re-rooting the DAG if it differs
+ * from the one we booted with */
+static void reconcile_prefix(void) {
+  host_prefix_received = 0;
+
+  if (prefix_set && uip_ipaddr_prefixcmp(&prefix, &host_prefix, 64)) {
+    PRINTF("Stored prefix confirmed by host\n");
+    return;
+  }
+
+  PRINTF("Host prefix differs from stored one, re-rooting DAG\n");
+  use_prefix(&host_prefix);
+  create_dag();
+  rpl_repair_root(BORDER_ROUTER_INSTANCE_ID);
+}
+
+/* 0 once the table is full, such nodes are not tracked */
+static uint8_t node_id_for(const uint8_t *node_iid) {
+  uint8_t i;
+
+  for (i = 0; i < node_count; ++i) {
+    if (memcmp(node_iids[i], node_iid, sizeof(node_iids[i])) == 0) {
+      return i + 1;
+    }
+  }
+
+  if (node_count == BORDER_ROUTER_NODES) {
+    return 0;
+  }
+  memcpy(node_iids[node_count], node_iid, sizeof(node_iids[node_count]));
+  return ++node_count;
+}
+
+static sensor_measurement *measurement_for(uint8_t node_id) {
+  int i;
+
+  for (i = 0; i < MAX_SENSOR_NODES; ++i) {
+    if (sensor_measurements[i].node_id == node_id) {
+      return &sensor_measurements[i];
+    }
+  }
+
+  for (i = 0; i < MAX_SENSOR_NODES; ++i) {
+    if (sensor_measurements[i].node_id == 0) {
+      memset(&sensor_measurements[i], 0, sizeof(sensor_measurement));
+      sensor_measurements[i].node_id = node_id;
+      return &sensor_measurements[i];
+    }
+  }
+
+  return NULL;
+}
+
+static void temp_from_sixteenths(temp_t *temp, int16_t sixteenths) {
+  uint16_t absraw;
+  int16_t sign;
+
+  sign = sixteenths < 0 ? -1 : 1;
+  absraw = sixteenths * sign;
+
+  temp->tempint = (absraw >> 4) * sign;
+  /* Info in 1/10000 of degree */
+  temp->tempfrac = (absraw % 16) * 625;
+  temp->minus = ((temp->tempint == 0) & (sign == -1)) ? '-' : ' ';
+}
+
+static int16_t sixteenths_from_temp(const temp_t *temp) {
+  int16_t sixteenths;
+
+  sixteenths = abs(temp->tempint) * 16 + temp->tempfrac / 625;
+
+  return (temp->tempint < 0 || temp->minus == '-') ? -sixteenths : sixteenths;
+}
+
+/* Applies the readings of one sample to a node's measurement, returns 1 if
+ * temperature or light were among them */
+static int apply_readings(sensor_measurement *m, const uint8_t *readings, uint8_t len) {
+  const uint8_t *value;
+  uint8_t id;
+  uint8_t value_len;
+  int16_t sixteenths;
+  int core_updated;
+
+  core_updated = 0;
+  while (len >= SENSOR_READING_HDR_LEN) {
+    id = readings[0];
+    value_len = readings[1];
+    value = &readings[SENSOR_READING_HDR_LEN];
+    if (SENSOR_READING_HDR_LEN + value_len > len) {
+      PRINTF("Truncated reading from %d\n", m->node_id);
+      break;
+    }
+
+    /* Values are unaligned, sensors unknown to this build are skipped */
+    if (id == SENSOR_ID_TEMPERATURE && value_len == sizeof(int16_t)) {
+      memcpy(&sixteenths, value, sizeof(int16_t));
+      temp_from_sixteenths(&m->temperature, sixteenths);
+      core_updated = 1;
+    } else if (id == SENSOR_ID_LIGHT && value_len == sizeof(m->light_intensity)) {
+      memcpy(&m->light_intensity, value, value_len);
+      core_updated = 1;
+    } else if (id == SENSOR_ID_ACCEL && value_len == sizeof(m->accel)) {
+      memcpy(m->accel, value, value_len);
+    } else if (id == SENSOR_ID_BATTERY && value_len == sizeof(m->battery_mv)) {
+      memcpy(&m->battery_mv, value, value_len);
+    } else if (id == SENSOR_ID_ADC && value_len == sizeof(m->adc)) {
+      memcpy(m->adc, value, value_len);
+    } else if (id == SENSOR_ID_LINK && value_len == 2) {
+      m->tx_power = (int8_t)value[0];
+      m->link_prr = value[1];
+    } else if (id == SENSOR_ID_SEQ &&
+               (value_len == 2 || value_len == sizeof(m->sample_seq) + sizeof(m->sample_boot))) {
+      /* Older motes send the count without a boot number */
+      memcpy(&m->sample_seq, value, sizeof(m->sample_seq));
+      if (value_len > 2) {
+        memcpy(&m->sample_boot, value + sizeof(m->sample_seq), sizeof(m->sample_boot));
       }
+      m->sequenced = 1;
+    } else {
+      id = 0;
     }
+    if (id != 0) {
+      m->present |= SENSOR_PRESENT(id);
+    }
+
+    readings += SENSOR_READING_HDR_LEN + value_len;
+    len -= SENSOR_READING_HDR_LEN + value_len;
+  }
+
+  return core_updated;
+}
+
+static void ingest_sample(uint8_t node_id, const uint8_t *node_iid, const uint8_t *readings,
+                          uint8_t len, uint16_t age) {
+  static sensor_measurement overflow;
+  sensor_measurement *m;
+  sensor_packet packet;
+  sensor_packet summary;
+  int16_t summary_temp;
+  uint8_t flags;
+
+  if (!first_reading_seen) {
+    first_reading_seen = 1;
+    printf("First reading ingested %lu.%02u s after power-on\n",
+      clock_seconds(), (unsigned)((clock_time() % CLOCK_SECOND) * 100 / CLOCK_SECOND));
+  }
+
+  /* Nodes beyond the table are still logged, without merging partial samples */
+  m = node_id == 0 ? NULL : measurement_for(node_id);
+  if (m == NULL) {
+    memset(&overflow, 0, sizeof(overflow));
+    overflow.node_id = node_id;
+    m = &overflow;
+  }
+
+  /* The sequence number belongs to this sample only */
+  m->sample_seq = 0;
+  m->sample_boot = 0;
+  m->sequenced = 0;
+  if (!apply_readings(m, readings, len)) {
+    return;
+  }
+
+  memcpy(&packet.temperature, &m->temperature, sizeof(temp_t));
+  packet.light_intensity = m->light_intensity;
+
+  /* The age comes from the mote unchecked. One beyond the router's uptime
+   * would put the sample into the future. */
+  if (age > clock_seconds()) {
+    age = clock_seconds();
+  }
+
+  PRINTF("Data recv; temp: %c%d.%04d; light: %u; age: %u\n",
+    packet.temperature.minus,
+    packet.temperature.tempint,
+    packet.temperature.tempfrac,
+    packet.light_intensity,
+    age
+  );
+  PRINTF("From: %d\n", node_id);
+
+  rollup_add(node_id, clock_seconds() - age, sixteenths_from_temp(&packet.temperature),
+             packet.light_intensity);
+
+  /* Only what the anomaly filter considers worth it goes to the host at full
+   * resolution, the rest reaches it as periodic averages */
+  if (anomaly_filter_sample(node_id, sixteenths_from_temp(&packet.temperature),
+                            packet.light_intensity, &flags)) {
+    if (m->sequenced) {
+      flags |= RECORD_LOG_FLAG_SEQUENCED;
+    }
+    record_log_ingest(node_id, node_iid, &packet, m->sample_seq, m->sample_boot, age, flags);
+  }
+  if (anomaly_filter_summary(node_id, &summary_temp, &summary.light_intensity)) {
+    temp_from_sixteenths(&summary.temperature, summary_temp);
+    record_log_ingest(node_id, node_iid, &summary, 0, 0, 0, ANOMALY_FLAG_SUMMARY);
+  }
+#if WITH_COAP
+  coap_server_reading(node_id, &packet, age);
+#endif /* WITH_COAP */
+}
 
-    if (node_found == 0) {
-      for (i = 0; i < 3; ++i) {
-        if (sensor_measurements[i].node_id == 0) {
-          sensor_measurements[i].node_id = node_id;
-          //sensor_measurements[i].temperature = data->temperature;
-          sensor_measurements[i].temperature.minus = data->temperature.minus;
-          sensor_measurements[i].temperature.tempint = data->temperature.tempint;
-          sensor_measurements[i].temperature.tempfrac = data->temperature.tempfrac;
-          sensor_measurements[i].light_intensity = data->light_intensity;
+static void handle_sensor_packet(void) {
+  uint8_t node_id;
+  uint8_t *node_iid;
+  uint8_t *frame;
+  uint16_t len;
+  uint16_t pos;
+  uint16_t age;
+  uint8_t entry_len;
+  uint8_t count;
 
+  if (uip_newdata()) {
+    frame = (uint8_t *)uip_appdata;
+    len = uip_datalen();
+    node_iid = &UIP_IP_BUF->srcipaddr.u8[8];
+    node_id = node_id_for(node_iid);
+
+    if (len >= 1 && frame[0] == SENSOR_FRAME_SAMPLE) {
+      ingest_sample(node_id, node_iid, &frame[1], len - 1, 0);
+    } else if (len >= 2 && frame[0] == SENSOR_FRAME_BATCH) {
+      pos = 2;
+      for (count = frame[1]; count > 0; --count) {
+        if (pos + SENSOR_BATCH_ENTRY_HDR_LEN > len) {
           break;
         }
+        age = frame[pos] | (frame[pos + 1] << 8);
+        entry_len = frame[pos + 2];
+        pos += SENSOR_BATCH_ENTRY_HDR_LEN;
+        if (pos + entry_len > len) {
+          break;
+        }
+        ingest_sample(node_id, node_iid, &frame[pos], entry_len, age);
+        pos += entry_len;
+      }
+      if (count > 0) {
+        PRINTF("Malformed batch from %d\n", node_id);
       }
+    } else {
+      PRINTF("Unknown frame from %d\n", node_id);
     }
   }
 }
 
 PROCESS_THREAD(border_router_process, ev, data) {
   static struct etimer et;
-  rpl_dag_t *dag;
+  static clock_time_t request_interval;
+  static uint8_t prefix_confirmed;
   #if DEBUG_ENABLED
     static struct etimer energy_timer;
     static double energy_consumed;
@@ -228,29 +697,41 @@ PROCESS_THREAD(border_router_process, ev, data) {
 
   PROCESS_BEGIN();
 
+#if WITH_PROFILER
+  profiler_init();
+#endif /* WITH_PROFILER */
+
 /* While waiting for the prefix to be sent through the SLIP connection, the future
  * border router can join an existing DAG as a parent or child, or acquire a default
  * router that will later take precedence over the SLIP fallback interface.
  * Prevent that by turning the radio off until we are initialized as a DAG root.
+ * A prefix stored during a previous run lets us skip the wait entirely and
+ * reconcile with the host in the background.
  */
   prefix_set = 0;
+  prefix_confirmed = 0;
   NETSTACK_MAC.off(0);
 
   PROCESS_PAUSE();
   SENSORS_ACTIVATE(button_sensor);
   PRINTF("RPL-Border router started\n");
 
-  while(!prefix_set) {
-    etimer_set(&et, CLOCK_SECOND);
-    request_prefix();
-    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  if (load_stored_prefix()) {
+    request_interval = PREFIX_REQUEST_RECONCILE;
+  } else {
+    request_interval = PREFIX_REQUEST_FIRST_BOOT;
+    while(!host_prefix_received) {
+      etimer_set(&et, request_interval);
+      request_prefix();
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL || etimer_expired(&et));
+      request_interval = next_request_interval(request_interval, PREFIX_REQUEST_FIRST_BOOT_MAX);
+    }
+    host_prefix_received = 0;
+    use_prefix(&host_prefix);
+    prefix_confirmed = 1;
   }
 
-  dag = rpl_set_root(RPL_DEFAULT_INSTANCE, &local_address);
-  if(dag != NULL) {
-    rpl_set_prefix(dag, &prefix, 64);
-    PRINTF("created a new RPL dag\n");
-  }
+  create_dag();
 
   NETSTACK_MAC.on();
 
@@ -264,6 +745,11 @@ PROCESS_THREAD(border_router_process, ev, data) {
   udp_bind(udp_connection, UIP_HTONS(UDP_SERVER_PORT));
   PRINTF("UDP host established.\n");
 
+  if (!prefix_confirmed) {
+    request_prefix();
+    etimer_set(&et, request_interval);
+  }
+
   #if DEBUG_ENABLED
     etimer_set(&energy_timer, CLOCK_SECOND * 10);
   #endif
@@ -283,13 +769,25 @@ PROCESS_THREAD(border_router_process, ev, data) {
       }
     #endif
 
+    if (ev == PROCESS_EVENT_POLL && host_prefix_received) {
+      reconcile_prefix();
+      prefix_confirmed = 1;
+      etimer_stop(&et);
+    }
+
+    if (ev == PROCESS_EVENT_TIMER && data == &et && !prefix_confirmed) {
+      request_prefix();
+      request_interval = next_request_interval(request_interval, PREFIX_REQUEST_MAX_INTERVAL);
+      etimer_set(&et, request_interval);
+    }
+
     if (ev == tcpip_event) {
       handle_sensor_packet();
     }
 
     if (ev == sensors_event && data == &button_sensor) {
       PRINTF("Initiating global repair\n");
-      rpl_repair_root(RPL_DEFAULT_INSTANCE);
+      rpl_repair_root(BORDER_ROUTER_INSTANCE_ID);
     }
   }
 
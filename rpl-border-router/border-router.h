@@ -0,0 +1,54 @@
+/**
+ * \file
+ *         Shared state of the border router application
+ */
+
+#ifndef __BORDER_ROUTER_H__
+#define __BORDER_ROUTER_H__
+
+#include "contiki.h"
+#include "common.h"
+
+#define MAX_SENSOR_NODES 3
+
+/* Nodes the router tells apart by their interface id. The per-node tables
+ * (latest readings, rollups, anomaly models, CoAP history) are keyed on the
+ * id the router hands out to each of them, 1 to BORDER_ROUTER_NODES in the
+ * order they are first heard. Nodes beyond it get id 0: their samples are
+ * still logged and forwarded, unfiltered and without rollups. */
+#ifndef BORDER_ROUTER_CONF_NODES
+#define BORDER_ROUTER_NODES 8
+#else /* BORDER_ROUTER_CONF_NODES */
+#define BORDER_ROUTER_NODES BORDER_ROUTER_CONF_NODES
+#endif /* BORDER_ROUTER_CONF_NODES */
+
+/* Border routers of one deployment share the RPL instance and each roots its
+ * own DODAG in it. Motes join whichever root serves them best and move to
+ * another one when it fails. */
+#ifndef BORDER_ROUTER_CONF_INSTANCE_ID
+#define BORDER_ROUTER_INSTANCE_ID RPL_DEFAULT_INSTANCE
+#else /* BORDER_ROUTER_CONF_INSTANCE_ID */
+#define BORDER_ROUTER_INSTANCE_ID BORDER_ROUTER_CONF_INSTANCE_ID
+#endif /* BORDER_ROUTER_CONF_INSTANCE_ID */
+
+#define SENSOR_PRESENT(id) (1 << (id))
+
+typedef struct {
+  uint8_t node_id;
+  temp_t temperature;
+  uint16_t light_intensity;
+  int16_t accel[3];
+  uint16_t battery_mv;
+  uint16_t adc[2];
+  int8_t tx_power;    /* dBm */
+  uint8_t link_prr;   /* percent, 0xff while unknown */
+  uint16_t sample_seq;  /* of the last sample */
+  uint16_t sample_boot; /* of the last sample, 0 if the mote does not send one */
+  uint8_t sequenced;    /* whether the last sample carried SENSOR_ID_SEQ */
+  uint8_t present;    /* SENSOR_PRESENT() bits of the sensors reported so far */
+} sensor_measurement;
+
+/* Latest reading per node, slots with node_id 0 are unused */
+extern sensor_measurement sensor_measurements[MAX_SENSOR_NODES];
+
+#endif /* __BORDER_ROUTER_H__ */
@@ -0,0 +1,293 @@
+/**
+ * \file
+ *         CoAP interface to the sensor readings collected by the border router
+ */
+
+#include "contiki.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "erbium.h"
+#if WITH_COAP == 13
+#include "er-coap-13.h"
+#endif /* WITH_COAP == 13 */
+
+#include "anomaly-filter.h"
+#include "border-router.h"
+#include "coap-server.h"
+
+#define READING_LINE_LEN 32
+
+typedef struct {
+  uint32_t timestamp;
+  uint8_t node_id;
+  sensor_packet data;
+} history_entry;
+
+static history_entry history[COAP_SERVER_HISTORY_LEN];
+static uint8_t history_head;
+static uint8_t history_count;
+static uint16_t readings;
+
+PROCESS(coap_server_process, "CoAP server");
+
+static int format_reading(char *buf, int size, uint8_t node_id, const temp_t *temperature, uint16_t light) {
+  return snprintf(buf, size, "%u,%s%d.%04u,%u\n",
+    node_id,
+    temperature->minus == '-' ? "-" : "",
+    temperature->tempint,
+    temperature->tempfrac,
+    light);
+}
+
+static int format_fleet(char *buf, int size) {
+  int i;
+  int len;
+
+  len = 0;
+  for (i = 0; i < MAX_SENSOR_NODES && len < size; ++i) {
+    if (sensor_measurements[i].node_id != 0) {
+      len += format_reading(buf + len, size - len,
+        sensor_measurements[i].node_id,
+        &sensor_measurements[i].temperature,
+        sensor_measurements[i].light_intensity);
+    }
+  }
+
+  return len < size ? len : size;
+}
+
+static const sensor_measurement *find_measurement(uint8_t node_id) {
+  int i;
+
+  for (i = 0; i < MAX_SENSOR_NODES; ++i) {
+    if (node_id != 0 && sensor_measurements[i].node_id == node_id) {
+      return &sensor_measurements[i];
+    }
+  }
+
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+RESOURCE(nodes, METHOD_GET | HAS_SUB_RESOURCES, "nodes", "title=\"Sensor nodes, nodes/<id> for one node\";rt=\"sensor\"");
+
+void nodes_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset) {
+  const char *url;
+  const sensor_measurement *measurement;
+  int url_len;
+  int len;
+  int i;
+  unsigned node_id;
+
+  url_len = REST.get_url(request, &url);
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+
+  /* Plain "nodes" lists the known node ids */
+  if (url_len <= sizeof("nodes")) {
+    len = 0;
+    for (i = 0; i < MAX_SENSOR_NODES && len < preferred_size; ++i) {
+      if (sensor_measurements[i].node_id != 0) {
+        len += snprintf((char *)buffer + len, preferred_size - len, "%u\n", sensor_measurements[i].node_id);
+      }
+    }
+    REST.set_response_payload(response, buffer, len < preferred_size ? len : preferred_size);
+    return;
+  }
+
+  node_id = 0;
+  for (i = sizeof("nodes"); i < url_len && url[i] >= '0' && url[i] <= '9'; ++i) {
+    node_id = node_id * 10 + (url[i] - '0');
+  }
+
+  measurement = i == url_len && node_id <= 0xff ? find_measurement(node_id) : NULL;
+  if (measurement == NULL) {
+    REST.set_response_status(response, REST.status.NOT_FOUND);
+    return;
+  }
+
+  len = format_reading((char *)buffer, preferred_size, measurement->node_id,
+    &measurement->temperature, measurement->light_intensity);
+  REST.set_response_payload(response, buffer, len < preferred_size ? len : preferred_size);
+}
+
+/*---------------------------------------------------------------------------*/
+EVENT_RESOURCE(fleet, METHOD_GET, "fleet", "title=\"Latest reading of every node\";obs");
+
+void fleet_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset) {
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, buffer, format_fleet((char *)buffer, preferred_size));
+}
+
+/* Notifications are sent non-confirmable, so the number of observers is not
+ * bounded by the open transactions */
+void fleet_event_handler(resource_t *r) {
+  static char content[REST_MAX_CHUNK_SIZE];
+  coap_packet_t notification[1];
+
+  coap_init_message(notification, COAP_TYPE_NON, REST.status.OK, 0);
+  coap_set_header_content_type(notification, REST.type.TEXT_PLAIN);
+  coap_set_payload(notification, content, format_fleet(content, sizeof(content)));
+
+  REST.notify_subscribers(r, readings, notification);
+}
+
+/*---------------------------------------------------------------------------*/
+RESOURCE(history, METHOD_GET, "history", "title=\"Recent readings, block-wise\";rt=\"sensor\"");
+
+/* Renders the history line by line and copies out only the requested block */
+void history_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset) {
+  char line[READING_LINE_LEN];
+  const history_entry *entry;
+  int32_t position;
+  int32_t copied;
+  int line_len;
+  int skip;
+  int n;
+  uint8_t i;
+
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+
+  position = 0;
+  copied = 0;
+  for (i = 0; i < history_count && copied < preferred_size; ++i) {
+    entry = &history[(history_head + i) % COAP_SERVER_HISTORY_LEN];
+    line_len = snprintf(line, sizeof(line), "%lu,", (unsigned long)entry->timestamp);
+    line_len += format_reading(line + line_len, sizeof(line) - line_len, entry->node_id,
+      &entry->data.temperature, entry->data.light_intensity);
+    if (line_len > sizeof(line) - 1) {
+      line_len = sizeof(line) - 1;
+    }
+
+    if (position + line_len > *offset) {
+      skip = *offset > position ? *offset - position : 0;
+      n = line_len - skip;
+      if (n > preferred_size - copied) {
+        n = preferred_size - copied;
+      }
+      memcpy(buffer + copied, line + skip, n);
+      copied += n;
+    }
+    position += line_len;
+  }
+
+  if (copied == 0 && *offset > 0) {
+    REST.set_response_status(response, REST.status.BAD_OPTION);
+    REST.set_response_payload(response, "BlockOutOfScope", 15);
+    return;
+  }
+
+  REST.set_response_payload(response, buffer, copied);
+
+  /* Stop once the last line went out, the client must not ask for more */
+  *offset += copied;
+  if (i == history_count && *offset >= position) {
+    *offset = -1;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+RESOURCE(filter, METHOD_GET | METHOD_PUT | METHOD_POST, "filter", "title=\"Anomaly filter thresholds, PUT ?sigma=&tdev=&tstep=&ldev=&lstep=&summary=\"");
+
+/* Reads a numeric variable from the query or the payload, returns 0 if the
+ * variable is absent and -1 if it is malformed */
+static int get_number(void *request, const char *name, uint16_t *value) {
+  char number[6];
+  const char *str;
+  char *end;
+  unsigned long n;
+  int len;
+
+  len = REST.get_query_variable(request, name, &str);
+  if (len == 0) {
+    len = REST.get_post_variable(request, name, &str);
+  }
+  if (len == 0) {
+    return 0;
+  }
+  if (len >= sizeof(number)) {
+    return -1;
+  }
+
+  memcpy(number, str, len);
+  number[len] = '\0';
+  n = strtoul(number, &end, 10);
+  if (*end != '\0' || n > 0xffff) {
+    return -1;
+  }
+
+  *value = n;
+  return 1;
+}
+
+void filter_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset) {
+  anomaly_config config;
+  uint16_t sigma;
+  int len;
+  int ok;
+
+  anomaly_filter_get_config(&config);
+
+  if (REST.get_method_type(request) != METHOD_GET) {
+    sigma = config.sigma;
+    ok = get_number(request, "sigma", &sigma) >= 0 && sigma <= 0xff;
+    ok &= get_number(request, "tdev", &config.temp_min_dev) >= 0;
+    ok &= get_number(request, "tstep", &config.temp_max_step) >= 0;
+    ok &= get_number(request, "ldev", &config.light_min_dev) >= 0;
+    ok &= get_number(request, "lstep", &config.light_max_step) >= 0;
+    ok &= get_number(request, "summary", &config.summary_interval) >= 0;
+    if (!ok) {
+      REST.set_response_status(response, REST.status.BAD_REQUEST);
+      return;
+    }
+    config.sigma = sigma;
+    anomaly_filter_set_config(&config);
+    REST.set_response_status(response, REST.status.CHANGED);
+  }
+
+  len = snprintf((char *)buffer, preferred_size, "sigma=%u&tdev=%u&tstep=%u&ldev=%u&lstep=%u&summary=%u\n",
+    config.sigma, config.temp_min_dev, config.temp_max_step,
+    config.light_min_dev, config.light_max_step, config.summary_interval);
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, buffer, len < preferred_size ? len : preferred_size);
+}
+
+/*---------------------------------------------------------------------------*/
+void coap_server_reading(uint8_t node_id, const sensor_packet *data, uint16_t age) {
+  history_entry *entry;
+
+  if (history_count < COAP_SERVER_HISTORY_LEN) {
+    entry = &history[(history_head + history_count) % COAP_SERVER_HISTORY_LEN];
+    ++history_count;
+  } else {
+    entry = &history[history_head];
+    history_head = (history_head + 1) % COAP_SERVER_HISTORY_LEN;
+  }
+
+  entry->timestamp = clock_seconds() - age;
+  entry->node_id = node_id;
+  memcpy(&entry->data, data, sizeof(sensor_packet));
+
+  /* A batch from a mote causes a single notification */
+  ++readings;
+  process_poll(&coap_server_process);
+}
+
+PROCESS_THREAD(coap_server_process, ev, data) {
+  PROCESS_BEGIN();
+
+  rest_init_engine();
+  rest_activate_resource(&resource_nodes);
+  rest_activate_event_resource(&resource_fleet);
+  rest_activate_resource(&resource_history);
+  rest_activate_resource(&resource_filter);
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    fleet_event_handler(&resource_fleet);
+  }
+
+  PROCESS_END();
+}
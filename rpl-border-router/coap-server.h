@@ -0,0 +1,35 @@
+/**
+ * \file
+ *         CoAP interface to the sensor readings collected by the border router
+ *
+ *         Resources:
+ *           nodes        ids of the nodes with a reading
+ *           nodes/<id>   latest reading of one node
+ *           fleet        latest reading of every node, observable
+ *           history      recent readings, served block-wise
+ *           filter       thresholds of the anomaly filter, set with PUT or
+ *                        POST variables sigma, tdev, tstep, ldev, lstep and
+ *                        summary (seconds)
+ *
+ *         Readings are text lines "<node id>,<temperature>,<light>", history
+ *         lines are prefixed with the seconds since boot the sample was taken.
+ */
+
+#ifndef __COAP_SERVER_H__
+#define __COAP_SERVER_H__
+
+#include "contiki.h"
+#include "common.h"
+
+#ifndef COAP_SERVER_CONF_HISTORY_LEN
+#define COAP_SERVER_HISTORY_LEN 4
+#else /* COAP_SERVER_CONF_HISTORY_LEN */
+#define COAP_SERVER_HISTORY_LEN COAP_SERVER_CONF_HISTORY_LEN
+#endif /* COAP_SERVER_CONF_HISTORY_LEN */
+
+PROCESS_NAME(coap_server_process);
+
+/* Records a reading and schedules a notification of the fleet observers */
+void coap_server_reading(uint8_t node_id, const sensor_packet *data, uint16_t age);
+
+#endif /* __COAP_SERVER_H__ */
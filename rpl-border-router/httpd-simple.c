@@ -54,22 +54,64 @@
 #define CONNS WEBSERVER_CONF_CFS_CONNS
 #endif /* WEBSERVER_CONF_CFS_CONNS */
 
+/* Connections beyond the pool are answered with a 503, which needs a uIP
+ * connection of its own. With no more uIP connections than CONNS they are
+ * reset by uIP instead. */
+#if defined(WEBSERVER_CONF_CFS_CONNS) && UIP_CONNS <= CONNS
+#error "UIP_CONF_MAX_CONNECTIONS must exceed WEBSERVER_CONF_CFS_CONNS"
+#endif
+
 #ifndef WEBSERVER_CONF_CFS_URLCONV
 #define URLCONV 0
 #else /* WEBSERVER_CONF_CFS_URLCONV */
 #define URLCONV WEBSERVER_CONF_CFS_URLCONV
 #endif /* WEBSERVER_CONF_CFS_URLCONV */
 
+/* A client gets this long to send its request line, and may then stay idle
+ * for the idle timeout while the response goes out */
+#ifndef WEBSERVER_CONF_HEADER_TIMEOUT
+#define HEADER_TIMEOUT (CLOCK_SECOND * 2)
+#else /* WEBSERVER_CONF_HEADER_TIMEOUT */
+#define HEADER_TIMEOUT WEBSERVER_CONF_HEADER_TIMEOUT
+#endif /* WEBSERVER_CONF_HEADER_TIMEOUT */
+
+#define IDLE_TIMEOUT (CLOCK_SECOND * 10)
+
+/* A shared body with no readers left is reused for requests arriving within
+ * this time */
+#ifndef WEBSERVER_CONF_SHARED_MAX_AGE
+#define SHARED_MAX_AGE CLOCK_SECOND
+#else /* WEBSERVER_CONF_SHARED_MAX_AGE */
+#define SHARED_MAX_AGE WEBSERVER_CONF_SHARED_MAX_AGE
+#endif /* WEBSERVER_CONF_SHARED_MAX_AGE */
+
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
 
 MEMB(conns, struct httpd_state, CONNS);
 
+/* Connections turned away when the pool is full point here instead of to a
+ * state of their own */
+static char rejected;
+
+#if HTTPD_SHARED_RESPONSE
+static struct {
+  char name[HTTPD_PATHLEN];
+  char body[HTTPD_SHARED_BODY_LEN];
+  uint16_t len;
+  uint8_t readers;
+  uint8_t streamed;
+  clock_time_t generated;
+} shared;
+#endif /* HTTPD_SHARED_RESPONSE */
+
 #define ISO_nl      0x0a
 #define ISO_space   0x20
 #define ISO_period  0x2e
 #define ISO_slash   0x2f
 
+#define PSOCK_SEND_STR(s, str) PSOCK_SEND(s, (uint8_t *)(str), strlen(str))
+
 /*---------------------------------------------------------------------------*/
 static const char *NOT_FOUND = "<html><body bgcolor=\"white\">"
 "<center>"
@@ -83,7 +125,7 @@ PT_THREAD(send_string(struct httpd_state *s, const char *str))
 {
   PSOCK_BEGIN(&s->sout);
 
-  SEND_STRING(&s->sout, str);
+  PSOCK_SEND_STR(&s->sout, str);
 
   PSOCK_END(&s->sout);
 }
@@ -96,7 +138,7 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
 
   PSOCK_BEGIN(&s->sout);
 
-  SEND_STRING(&s->sout, statushdr);
+  PSOCK_SEND_STR(&s->sout, statushdr);
 
   /* ptr = strrchr(s->filename, ISO_period); */
   /* if(ptr == NULL) { */
@@ -115,12 +157,82 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
   /*   s->ptr = http_content_type_binary; */
   /* } */
   /* SEND_STRING(&s->sout, s->ptr); */
-  SEND_STRING(&s->sout, http_content_type_html);
+  PSOCK_SEND_STR(&s->sout, http_content_type_html);
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+#if HTTPD_SHARED_RESPONSE
+int
+httpd_simple_append(const char *str)
+{
+  uint16_t len;
+
+  len = strlen(str);
+  if(len > HTTPD_SHARED_STRING_MAX) {
+    printf("httpd: string of %u bytes cut to %u\n", len, HTTPD_SHARED_STRING_MAX);
+    len = HTTPD_SHARED_STRING_MAX;
+  }
+  memcpy(&shared.body[shared.len], str, len);
+  shared.len += len;
+
+  /* Send what there is while the next string still fits, the page then
+   * goes out in chunks to this client only */
+  if(sizeof(shared.body) - shared.len < HTTPD_SHARED_STRING_MAX) {
+    shared.streamed = 1;
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const uint8_t *
+httpd_simple_body(void)
+{
+  return (const uint8_t *)shared.body;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+httpd_simple_body_len(void)
+{
+  return shared.len;
+}
+/*---------------------------------------------------------------------------*/
+void
+httpd_simple_body_sent(void)
+{
+  shared.len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+shared_body_usable(struct httpd_state *s)
+{
+  return strcmp(shared.name, s->filename) == 0 &&
+    (shared.readers > 0 ||
+     (clock_time_t)(clock_time() - shared.generated) < SHARED_MAX_AGE);
+}
+/*---------------------------------------------------------------------------*/
+static void
+release_shared_body(struct httpd_state *s)
+{
+  if(s->shared) {
+    s->shared = 0;
+    --shared.readers;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_shared_body(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  PSOCK_SEND(&s->sout, (uint8_t *)shared.body, shared.len);
+
+  PSOCK_END(&s->sout);
+}
+#endif /* HTTPD_SHARED_RESPONSE */
+/*---------------------------------------------------------------------------*/
 const char http_header_200[] = "HTTP/1.0 200 OK\r\nServer: Contiki/2.4 http://www.sics.se/contiki/\r\nConnection: close\r\n";
 const char http_header_404[] = "HTTP/1.0 404 Not found\r\nServer: Contiki/2.4 http://www.sics.se/contiki/\r\nConnection: close\r\n";
+const char http_header_503[] = "HTTP/1.0 503 Service Unavailable\r\nRetry-After: 1\r\nConnection: close\r\n\r\n";
 static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
@@ -138,9 +250,39 @@ PT_THREAD(handle_output(struct httpd_state *s))
     webserver_log_file(&uip_conn->ripaddr, "404 - not found");
     PT_EXIT(&s->outputpt);
   } else {
+#if HTTPD_SHARED_RESPONSE
+    /* Join the body other readers are getting, otherwise wait until nobody
+     * reads the buffer and render a new one */
+    PT_WAIT_UNTIL(&s->outputpt,
+                  shared_body_usable(s) || shared.readers == 0);
+    if(shared_body_usable(s)) {
+      ++shared.readers;
+      s->shared = 1;
+      PT_WAIT_THREAD(&s->outputpt,
+                     send_headers(s, http_header_200));
+    } else {
+      /* Nobody joins until the page is complete, a streamed page is never
+       * complete in the buffer */
+      ++shared.readers;
+      s->shared = 1;
+      shared.name[0] = 0;
+      shared.len = 0;
+      shared.streamed = 0;
+      PT_WAIT_THREAD(&s->outputpt,
+                     send_headers(s, http_header_200));
+      PT_WAIT_THREAD(&s->outputpt, s->script(s));
+      if(!shared.streamed) {
+        strcpy(shared.name, s->filename);
+        shared.generated = clock_time();
+      }
+    }
+    PT_WAIT_THREAD(&s->outputpt, send_shared_body(s));
+    release_shared_body(s);
+#else /* HTTPD_SHARED_RESPONSE */
     PT_WAIT_THREAD(&s->outputpt,
                    send_headers(s, http_header_200));
     PT_WAIT_THREAD(&s->outputpt, s->script(s));
+#endif /* HTTPD_SHARED_RESPONSE */
   }
   s->script = NULL;
   PSOCK_CLOSE(&s->sout);
@@ -176,11 +318,13 @@ PT_THREAD(handle_input(struct httpd_state *s))
     s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
     strncpy(s->filename, s->inputbuf, sizeof(s->filename));
   }
+  s->filename[sizeof(s->filename) - 1] = 0;
 #endif /* URLCONV */
 
   webserver_log_file(&uip_conn->ripaddr, s->filename);
 
   s->state = STATE_OUTPUT;
+  timer_set(&s->timer, IDLE_TIMEOUT);
 
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
@@ -204,22 +348,49 @@ handle_connection(struct httpd_state *s)
   }
 }
 
+/*---------------------------------------------------------------------------*/
+static void
+free_state(struct httpd_state *s)
+{
+  s->script = NULL;
+#if HTTPD_SHARED_RESPONSE
+  release_shared_body(s);
+#endif /* HTTPD_SHARED_RESPONSE */
+  memb_free(&conns, s);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends the 503 on connect and on retransmissions, and closes once it is
+ * acknowledged. The request itself is never read. */
+static void
+handle_rejected(void)
+{
+  if(uip_closed() || uip_aborted() || uip_timedout()) {
+    return;
+  }
+  if(uip_acked()) {
+    uip_close();
+  } else if(uip_connected() || uip_rexmit()) {
+    uip_send(http_header_503, sizeof(http_header_503) - 1);
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 httpd_appcall(void *state)
 {
   struct httpd_state *s = (struct httpd_state *)state;
 
-  if(uip_closed() || uip_aborted() || uip_timedout()) {
+  if(state == &rejected) {
+    handle_rejected();
+  } else if(uip_closed() || uip_aborted() || uip_timedout()) {
     if(s != NULL) {
-      s->script = NULL;
-      memb_free(&conns, s);
+      free_state(s);
     }
   } else if(uip_connected()) {
     s = (struct httpd_state *)memb_alloc(&conns);
     if(s == NULL) {
-      uip_abort();
-      webserver_log_file(&uip_conn->ripaddr, "reset (no memory block)");
+      tcp_markconn(uip_conn, &rejected);
+      handle_rejected();
+      webserver_log_file(&uip_conn->ripaddr, "503 (no memory block)");
       return;
     }
     tcp_markconn(uip_conn, s);
@@ -228,17 +399,20 @@ httpd_appcall(void *state)
     PT_INIT(&s->outputpt);
     s->script = NULL;
     s->state = STATE_WAITING;
-    timer_set(&s->timer, CLOCK_SECOND * 10);
+    s->shared = 0;
+    timer_set(&s->timer, HEADER_TIMEOUT);
     handle_connection(s);
   } else if(s != NULL) {
     if(uip_poll()) {
       if(timer_expired(&s->timer)) {
         uip_abort();
-        s->script = NULL;
-        memb_free(&conns, s);
+        free_state(s);
         webserver_log_file(&uip_conn->ripaddr, "reset (timeout)");
+        return;
       }
-    } else {
+    } else if(s->state == STATE_OUTPUT) {
+      /* The header phase has a fixed deadline, trickling bytes does not
+       * extend it */
       timer_restart(&s->timer);
     }
     handle_connection(s);
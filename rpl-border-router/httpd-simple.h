@@ -50,6 +50,31 @@
 #define HTTPD_PATHLEN WEBSERVER_CONF_CFS_PATHLEN
 #endif /* WEBSERVER_CONF_CFS_CONNS */
 
+/* Concurrent GETs of the same resource are answered from one body, which
+ * the script renders into a shared buffer in a single pass. A page that
+ * outgrows the buffer is streamed to the client that asked for it in
+ * buffer-sized chunks instead, and is not shared. */
+#ifndef WEBSERVER_CONF_SHARED_RESPONSE
+#define HTTPD_SHARED_RESPONSE 1
+#else /* WEBSERVER_CONF_SHARED_RESPONSE */
+#define HTTPD_SHARED_RESPONSE WEBSERVER_CONF_SHARED_RESPONSE
+#endif /* WEBSERVER_CONF_SHARED_RESPONSE */
+
+#ifndef WEBSERVER_CONF_SHARED_BODY_LEN
+#define HTTPD_SHARED_BODY_LEN 256
+#else /* WEBSERVER_CONF_SHARED_BODY_LEN */
+#define HTTPD_SHARED_BODY_LEN WEBSERVER_CONF_SHARED_BODY_LEN
+#endif /* WEBSERVER_CONF_SHARED_BODY_LEN */
+
+/* Longest string a script passes to SEND_STRING. The body is flushed while
+ * it still has room for one, so that a string is always appended before
+ * the script yields; longer strings are cut. */
+#define HTTPD_SHARED_STRING_MAX 80
+
+#if HTTPD_SHARED_RESPONSE && HTTPD_SHARED_BODY_LEN < 2 * HTTPD_SHARED_STRING_MAX
+#error "WEBSERVER_CONF_SHARED_BODY_LEN is too short to stream pages through"
+#endif
+
 struct httpd_state;
 typedef char (* httpd_simple_script_t)(struct httpd_state *s);
 
@@ -62,6 +87,7 @@ struct httpd_state {
   char filename[HTTPD_PATHLEN];
   httpd_simple_script_t script;
   char state;
+  char shared;
 };
 
 void httpd_init(void);
@@ -69,6 +95,21 @@ void httpd_appcall(void *state);
 
 httpd_simple_script_t httpd_simple_get_script(const char *name);
 
+#if HTTPD_SHARED_RESPONSE
+/* Appends to the shared body, returns 1 when the body has to be sent to the
+ * client before the script goes on */
+int httpd_simple_append(const char *str);
+const uint8_t *httpd_simple_body(void);
+uint16_t httpd_simple_body_len(void);
+void httpd_simple_body_sent(void);
+#define SEND_STRING(s, str) do {                                      \
+    if(httpd_simple_append(str)) {                                    \
+      PSOCK_SEND(s, httpd_simple_body(), httpd_simple_body_len());    \
+      httpd_simple_body_sent();                                       \
+    }                                                                 \
+  } while(0)
+#else /* HTTPD_SHARED_RESPONSE */
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, strlen(str))
+#endif /* HTTPD_SHARED_RESPONSE */
 
 #endif /* __HTTPD_SIMPLE_H__ */
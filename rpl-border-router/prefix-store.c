@@ -0,0 +1,85 @@
+/**
+ * \file
+ *         Persistent storage of the border router prefix and DAG configuration
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+
+#include <string.h>
+
+#include "prefix-store.h"
+#include "common.h"
+
+#define PREFIX_STORE_MAGIC   0xb7
+#define PREFIX_STORE_VERSION 1
+
+/* On-flash layout, only the upper 64 bits of the prefix are kept */
+typedef struct {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t instance_id;
+  uint8_t prefix_len;
+  uint8_t prefix[8];
+} stored_prefix;
+
+static int read_stored(stored_prefix *stored) {
+  int fd;
+  int len;
+
+  fd = cfs_open(PREFIX_STORE_FILENAME, CFS_READ);
+  if (fd < 0) {
+    return 0;
+  }
+  len = cfs_read(fd, stored, sizeof(stored_prefix));
+  cfs_close(fd);
+
+  return len == sizeof(stored_prefix) &&
+         stored->magic == PREFIX_STORE_MAGIC &&
+         stored->version == PREFIX_STORE_VERSION &&
+         stored->prefix_len <= 64;
+}
+
+int prefix_store_load(prefix_config *config) {
+  stored_prefix stored;
+
+  if (!read_stored(&stored)) {
+    return 0;
+  }
+
+  memset(&config->prefix, 0, sizeof(config->prefix));
+  memcpy(&config->prefix, stored.prefix, sizeof(stored.prefix));
+  config->prefix_len = stored.prefix_len;
+  config->instance_id = stored.instance_id;
+
+  return 1;
+}
+
+int prefix_store_save(const prefix_config *config) {
+  stored_prefix stored;
+  stored_prefix current;
+  int fd;
+  int len;
+
+  stored.magic = PREFIX_STORE_MAGIC;
+  stored.version = PREFIX_STORE_VERSION;
+  stored.instance_id = config->instance_id;
+  stored.prefix_len = config->prefix_len;
+  memcpy(stored.prefix, &config->prefix, sizeof(stored.prefix));
+
+  /* Spare the flash if nothing changed since the last boot */
+  if (read_stored(&current) && memcmp(&current, &stored, sizeof(stored)) == 0) {
+    return 1;
+  }
+
+  cfs_remove(PREFIX_STORE_FILENAME);
+  fd = cfs_open(PREFIX_STORE_FILENAME, CFS_WRITE);
+  if (fd < 0) {
+    PRINTF("Could not open %s for writing\n", PREFIX_STORE_FILENAME);
+    return 0;
+  }
+  len = cfs_write(fd, &stored, sizeof(stored));
+  cfs_close(fd);
+
+  return len == sizeof(stored);
+}
@@ -0,0 +1,34 @@
+/**
+ * \file
+ *         Persistent storage of the border router prefix and DAG configuration
+ *
+ *         The last prefix handed out by the host is kept in flash so that the
+ *         border router can become DAG root right after a reboot, without
+ *         waiting for tunslip to answer the prefix request.
+ */
+
+#ifndef __PREFIX_STORE_H__
+#define __PREFIX_STORE_H__
+
+#include "contiki.h"
+#include "net/uip.h"
+
+#ifndef PREFIX_STORE_CONF_FILENAME
+#define PREFIX_STORE_FILENAME "brprefix"
+#else /* PREFIX_STORE_CONF_FILENAME */
+#define PREFIX_STORE_FILENAME PREFIX_STORE_CONF_FILENAME
+#endif /* PREFIX_STORE_CONF_FILENAME */
+
+typedef struct {
+  uip_ipaddr_t prefix;
+  uint8_t prefix_len;
+  uint8_t instance_id;
+} prefix_config;
+
+/* Returns 1 and fills config if a valid configuration was stored, 0 otherwise */
+int prefix_store_load(prefix_config *config);
+
+/* Writes config to flash unless the stored copy is already identical */
+int prefix_store_save(const prefix_config *config);
+
+#endif /* __PREFIX_STORE_H__ */
@@ -0,0 +1,146 @@
+/**
+ * \file
+ *         Run time profile of the border router's processes
+ */
+
+#include "contiki.h"
+#include "net/mac/mac.h"
+#include "net/rime.h"
+
+#include "profiler.h"
+
+/* Look for processes started since the last scan this often */
+#define SCAN_INTERVAL (CLOCK_SECOND * 5)
+
+/* Clock ticks after which the 16 bit rtimer may have wrapped during a
+ * dispatch, one tick short of a full wrap for the clock's resolution */
+#define RTIMER_PER_CLOCK  ((uint32_t)RTIMER_SECOND / CLOCK_SECOND)
+#define LONG_DISPATCH     ((clock_time_t)(0x10000UL / RTIMER_PER_CLOCK - 1))
+
+#if !PROCESS_CONF_STATS
+#error "The profiler needs PROCESS_CONF_STATS for the event queue peak"
+#endif /* !PROCESS_CONF_STATS */
+
+/* Kept by process_post(), process.h does not declare it */
+extern process_num_events_t process_maxevents;
+
+typedef char (* thread_t)(struct pt *, process_event_t, process_data_t);
+
+static profiler_stats stats[PROFILER_MAX_PROCESSES];
+static thread_t threads[PROFILER_MAX_PROCESSES];
+static uint8_t tracked;
+static uint8_t untracked;
+static uint16_t mac_drops;
+
+/* Ticks spent in synchronous dispatches below the current one */
+static uint32_t nested;
+
+PROCESS(profiler_process, "Profiler");
+
+static char profiled_thread(struct pt *pt, process_event_t ev, process_data_t data) {
+  rtimer_clock_t start;
+  clock_time_t clock_start;
+  clock_time_t clock_elapsed;
+  uint32_t elapsed;
+  uint32_t outer_nested;
+  uint32_t own;
+  profiler_stats *s;
+  uint8_t i;
+  char ret;
+
+  /* The thread is found through its protothread, which lives in the process */
+  for (i = 0; i < tracked && &stats[i].p->pt != pt; ++i);
+  s = &stats[i];
+
+  outer_nested = nested;
+  nested = 0;
+  clock_start = clock_time();
+  start = RTIMER_NOW();
+  ret = threads[i](pt, ev, data);
+  elapsed = (rtimer_clock_t)(RTIMER_NOW() - start);
+  clock_elapsed = clock_time() - clock_start;
+
+  if (clock_elapsed >= LONG_DISPATCH) {
+    elapsed = clock_elapsed * RTIMER_PER_CLOCK;
+    ++s->long_dispatches;
+  }
+
+  own = elapsed > nested ? elapsed - nested : 0;
+  ++s->dispatches;
+  s->total += own;
+  if (own > s->max) {
+    s->max = own;
+  }
+  nested = outer_nested + elapsed;
+
+  return ret;
+}
+
+static void wrap_new_processes(void) {
+  struct process *p;
+
+  for (p = process_list; p != NULL; p = p->next) {
+    if (p->thread == profiled_thread) {
+      continue;
+    }
+    if (tracked == PROFILER_MAX_PROCESSES) {
+      ++untracked;
+      continue;
+    }
+    stats[tracked].p = p;
+    threads[tracked] = p->thread;
+    ++tracked;
+    p->thread = profiled_thread;
+  }
+}
+
+static void packet_input(void) {
+}
+
+static void packet_output(int mac_status) {
+  if (mac_status == MAC_TX_ERR) {
+    ++mac_drops;
+  }
+}
+
+RIME_SNIFFER(profiler_sniffer, packet_input, packet_output);
+
+PROCESS_THREAD(profiler_process, ev, data) {
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  rime_sniffer_add(&profiler_sniffer);
+  etimer_set(&et, SCAN_INTERVAL);
+
+  while(1) {
+    /* Processes beyond the table are counted again on every scan */
+    untracked = 0;
+    wrap_new_processes();
+
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+  }
+
+  PROCESS_END();
+}
+
+void profiler_init(void) {
+  process_start(&profiler_process, NULL);
+}
+
+const profiler_stats *profiler_get(int i) {
+  return i < tracked ? &stats[i] : NULL;
+}
+
+uint8_t profiler_event_queue_peak(void) {
+  return process_maxevents;
+}
+
+uint16_t profiler_mac_drops(void) {
+  return mac_drops;
+}
+
+uint8_t profiler_untracked(void) {
+  return untracked;
+}
@@ -0,0 +1,53 @@
+/**
+ * \file
+ *         Run time profile of the border router's processes
+ *
+ *         Every running process gets its thread function wrapped, so each
+ *         dispatch is counted and timed with the rtimer clock. Time spent in
+ *         processes called synchronously from another one is only charged to
+ *         the callee. The 16 bit rtimer wraps after 2 s on the Z1, so
+ *         dispatches that long are timed with the system clock instead and
+ *         counted as long. The depth of the event queue comes from the
+ *         kernel's process_maxevents (PROCESS_CONF_STATS), and the MAC layer's
+ *         transmit errors are counted as buffer drops (csma reports a full
+ *         packet queue as MAC_TX_ERR).
+ *
+ *         The cost is two rtimer and two clock reads and a short table walk
+ *         per dispatch.
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include "contiki.h"
+
+#ifndef PROFILER_CONF_MAX_PROCESSES
+#define PROFILER_MAX_PROCESSES 12
+#else /* PROFILER_CONF_MAX_PROCESSES */
+#define PROFILER_MAX_PROCESSES PROFILER_CONF_MAX_PROCESSES
+#endif /* PROFILER_CONF_MAX_PROCESSES */
+
+typedef struct {
+  struct process *p;
+  uint32_t dispatches;
+  uint32_t total;        /* rtimer ticks */
+  uint32_t max;          /* rtimer ticks */
+  uint16_t long_dispatches; /* timed in clock ticks, the rtimer may have wrapped */
+} profiler_stats;
+
+/* Starts the process that keeps wrapping newly started processes */
+void profiler_init(void);
+
+/* Returns the stats of the i-th profiled process, NULL past the last one */
+const profiler_stats *profiler_get(int i);
+
+/* Most events ever waiting in the queue as the kernel counts them,
+ * PROCESS_CONF_NUMEVENTS means that posts may have been lost */
+uint8_t profiler_event_queue_peak(void);
+
+uint16_t profiler_mac_drops(void);
+
+/* Processes that did not fit in the table and run unprofiled */
+uint8_t profiler_untracked(void);
+
+#endif /* __PROFILER_H__ */
@@ -31,6 +31,8 @@
 #ifndef __PROJECT_ROUTER_CONF_H__
 #define __PROJECT_ROUTER_CONF_H__
 
+#include "lowpan-conf.h"
+
 #ifndef UIP_FALLBACK_INTERFACE
 #define UIP_FALLBACK_INTERFACE rpl_interface
 #endif
@@ -47,10 +49,43 @@
 #define UIP_CONF_RECEIVE_WINDOW  60
 #endif
 
+/* Responses are rendered once into a shared body, so more connections only
+ * cost their protocol state, about 100 bytes of RAM each with the uIP
+ * connection */
 #ifndef WEBSERVER_CONF_CFS_CONNS
 #define WEBSERVER_CONF_CFS_CONNS 2
 #endif
 
+/* The webserver is the router's only TCP user. One uIP connection more than
+ * it serves lets it answer the next client with a 503 instead of a reset. */
+#ifndef UIP_CONF_MAX_CONNECTIONS
+#define UIP_CONF_MAX_CONNECTIONS (WEBSERVER_CONF_CFS_CONNS + 1)
+#endif
+
+/* Long enough for "/stats" and "/index.html" */
+#ifndef WEBSERVER_CONF_CFS_PATHLEN
+#define WEBSERVER_CONF_CFS_PATHLEN 12
+#endif
+
+#if WITH_PROFILER
+/* The kernel keeps the event queue peak for the profiler */
+#define PROCESS_CONF_STATS 1
+#endif /* WITH_PROFILER */
+
+/* Keep CoAP blocks small enough to fit the uIP buffer unfragmented */
+#ifndef REST_MAX_CHUNK_SIZE
+#define REST_MAX_CHUNK_SIZE     64
+#endif
+
+#ifndef COAP_MAX_OPEN_TRANSACTIONS
+#define COAP_MAX_OPEN_TRANSACTIONS 2
+#endif
+
+/* About 34 bytes of RAM per observer */
+#ifndef COAP_MAX_OBSERVERS
+#define COAP_MAX_OBSERVERS       2
+#endif
+
 #define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 4
 #define NETSTACK_CONF_RDC contikimac_driver
 
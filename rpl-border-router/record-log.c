@@ -0,0 +1,323 @@
+/**
+ * \file
+ *         Store-and-forward log of ingested sensor records
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "net/uip-udp-packet.h"
+
+#include <string.h>
+
+#include "record-log.h"
+
+#define RECORD_LOG_FILENAME    "rlog"
+#define RECORD_CURSOR_FILENAME "rlogpos"
+
+/* Changed whenever the record layout changes, slots of older builds then read
+ * as empty */
+#define RECORD_CHECK  0xa8
+#define CURSOR_MAGIC  0x52
+
+/* Probe the host with a prefix request when it has been quiet for a while and
+ * consider it gone when even the probes stay unanswered */
+#define HOST_PROBE_INTERVAL (CLOCK_SECOND * 10)
+#define HOST_LINK_TIMEOUT   (CLOCK_SECOND * 35)
+
+/* Persist the replay position every few batches rather than every batch, a
+ * reboot in between only causes a few duplicate records upstream */
+#define CURSOR_SAVE_BATCHES 16
+
+typedef struct {
+  uint8_t magic;
+  uint16_t epoch;
+  uint32_t replayed_seq;
+} record_cursor;
+
+void request_prefix(void);
+
+static uint32_t head_seq;      /* last sequence number handed out */
+static uint32_t replayed_seq;  /* last sequence number sent to the host */
+static uint32_t evicted;
+static uint16_t epoch;
+static uint8_t host_up;
+static clock_time_t host_last_seen;
+static struct uip_udp_conn *host_connection;
+static uip_ipaddr_t host_address;
+static uint8_t host_address_set;
+static uint8_t frame_buf[2 + RECORD_LOG_BATCH * sizeof(log_record)];
+
+/* Records ingested while the host is up wait here for record_log_process,
+ * ingest runs while uip_buf still holds the mote's datagram */
+static log_record live[RECORD_LOG_BATCH];
+static uint8_t live_count;
+
+typedef char record_log_batch_fits[
+  UIP_IPUDPH_LEN + sizeof(frame_buf) <= UIP_BUFSIZE - UIP_LLH_LEN ? 1 : -1];
+
+PROCESS(record_log_process, "Record log process");
+
+static void save_cursor(void) {
+  record_cursor cursor;
+  int fd;
+
+  cursor.magic = CURSOR_MAGIC;
+  cursor.epoch = epoch;
+  cursor.replayed_seq = replayed_seq;
+
+  fd = cfs_open(RECORD_CURSOR_FILENAME, CFS_WRITE);
+  if (fd >= 0) {
+    cfs_write(fd, &cursor, sizeof(cursor));
+    cfs_close(fd);
+  }
+}
+
+static int read_slot(uint32_t seq, log_record *record) {
+  int fd;
+  int len;
+
+  fd = cfs_open(RECORD_LOG_FILENAME, CFS_READ);
+  if (fd < 0) {
+    return 0;
+  }
+  cfs_seek(fd, (seq % RECORD_LOG_SLOTS) * sizeof(log_record), CFS_SEEK_SET);
+  len = cfs_read(fd, record, sizeof(log_record));
+  cfs_close(fd);
+
+  return len == sizeof(log_record) && record->check == RECORD_CHECK;
+}
+
+static void write_slot(const log_record *record) {
+  int fd;
+
+  fd = cfs_open(RECORD_LOG_FILENAME, CFS_READ | CFS_WRITE);
+  if (fd < 0) {
+    PRINTF("Could not open record log, dropping record %lu\n", (unsigned long)record->seq);
+    return;
+  }
+  cfs_seek(fd, (record->seq % RECORD_LOG_SLOTS) * sizeof(log_record), CFS_SEEK_SET);
+  cfs_write(fd, record, sizeof(log_record));
+  cfs_close(fd);
+}
+
+/* Rebuilds the ring position from flash, the newest valid slot is the head */
+static void record_log_init(void) {
+  record_cursor cursor;
+  log_record record;
+  int fd;
+  int i;
+
+  cfs_coffee_reserve(RECORD_LOG_FILENAME, RECORD_LOG_SLOTS * sizeof(log_record));
+
+  head_seq = 0;
+  replayed_seq = 0;
+  epoch = 0;
+
+  fd = cfs_open(RECORD_CURSOR_FILENAME, CFS_READ);
+  if (fd >= 0) {
+    if (cfs_read(fd, &cursor, sizeof(cursor)) == sizeof(cursor) && cursor.magic == CURSOR_MAGIC) {
+      epoch = cursor.epoch;
+      replayed_seq = cursor.replayed_seq;
+    }
+    cfs_close(fd);
+  }
+
+  fd = cfs_open(RECORD_LOG_FILENAME, CFS_READ);
+  if (fd >= 0) {
+    for (i = 0; i < RECORD_LOG_SLOTS; ++i) {
+      if (cfs_read(fd, &record, sizeof(record)) != sizeof(record)) {
+        break;
+      }
+      if (record.check == RECORD_CHECK && record.seq > head_seq) {
+        head_seq = record.seq;
+      }
+    }
+    cfs_close(fd);
+  }
+
+  /* Records forwarded live are never written, so the cursor may be ahead */
+  if (replayed_seq > head_seq) {
+    head_seq = replayed_seq;
+  }
+  if (head_seq - replayed_seq > RECORD_LOG_SLOTS) {
+    replayed_seq = head_seq - RECORD_LOG_SLOTS;
+  }
+
+  ++epoch;
+  save_cursor();
+
+  PRINTF("Record log: epoch %u, %lu records pending\n", epoch, (unsigned long)(head_seq - replayed_seq));
+}
+
+static int can_send(void) {
+  return host_up && host_address_set && host_connection != NULL;
+}
+
+static void send_records(const log_record *records, uint8_t count) {
+  frame_buf[0] = 'R';
+  frame_buf[1] = count;
+  memcpy(&frame_buf[2], records, count * sizeof(log_record));
+  uip_udp_packet_sendto(host_connection, frame_buf, 2 + count * sizeof(log_record),
+                        &host_address, UIP_HTONS(RECORD_LOG_PORT));
+}
+
+/* Moves the records waiting for a live send into the log, where the replay
+ * picks them up in order */
+static void spill_live(void) {
+  uint8_t i;
+
+  for (i = 0; i < live_count; ++i) {
+    write_slot(&live[i]);
+  }
+  live_count = 0;
+}
+
+static void flush_live(void) {
+  if (live_count == 0) {
+    return;
+  }
+  if (!can_send()) {
+    spill_live();
+    return;
+  }
+  send_records(live, live_count);
+  replayed_seq += live_count;
+  live_count = 0;
+}
+
+/* Sends the next batch of logged records, returns 1 while more are pending */
+static int replay_batch(void) {
+  static log_record batch[RECORD_LOG_BATCH];
+  static uint8_t batches_since_save;
+  uint8_t count;
+
+  count = 0;
+  while (count < RECORD_LOG_BATCH && replayed_seq < head_seq) {
+    ++replayed_seq;
+    if (read_slot(replayed_seq, &batch[count]) && batch[count].seq == replayed_seq) {
+      ++count;
+    }
+  }
+
+  if (count > 0) {
+    send_records(batch, count);
+  }
+
+  if (replayed_seq == head_seq || ++batches_since_save >= CURSOR_SAVE_BATCHES) {
+    batches_since_save = 0;
+    save_cursor();
+  }
+
+  return replayed_seq < head_seq;
+}
+
+void record_log_ingest(uint8_t node_id, const uint8_t *node_iid, const sensor_packet *data,
+                       uint16_t sample_seq, uint16_t sample_boot, uint16_t age, uint8_t flags) {
+  log_record record;
+
+  record.seq = ++head_seq;
+  record.timestamp = clock_seconds() - age;
+  record.epoch = epoch;
+  memcpy(&record.data, data, sizeof(sensor_packet));
+  record.sample_seq = sample_seq;
+  record.sample_boot = sample_boot;
+  memcpy(record.node_iid, node_iid, sizeof(record.node_iid));
+  record.node_id = node_id;
+  record.flags = flags;
+  record.check = RECORD_CHECK;
+
+  /* Keep ordering: only bypass the log when nothing is waiting for replay */
+  if (can_send() && live_count < RECORD_LOG_BATCH &&
+      replayed_seq + live_count == head_seq - 1) {
+    memcpy(&live[live_count++], &record, sizeof(log_record));
+    process_poll(&record_log_process);
+    return;
+  }
+
+  spill_live();
+  write_slot(&record);
+
+  if (head_seq - replayed_seq > RECORD_LOG_SLOTS) {
+    replayed_seq = head_seq - RECORD_LOG_SLOTS;
+    ++evicted;
+  }
+}
+
+void record_log_set_prefix(const uip_ipaddr_t *prefix) {
+  memset(&host_address, 0, sizeof(host_address));
+  memcpy(&host_address, prefix, 8);
+  host_address.u8[14] = RECORD_LOG_HOST_IID >> 8;
+  host_address.u8[15] = RECORD_LOG_HOST_IID & 0xff;
+  host_address_set = 1;
+}
+
+void record_log_host_alive(void) {
+  host_last_seen = clock_time();
+  if (!host_up) {
+    host_up = 1;
+    process_poll(&record_log_process);
+  }
+}
+
+int record_log_host_up(void) {
+  return host_up;
+}
+
+uint32_t record_log_pending(void) {
+  return head_seq - replayed_seq;
+}
+
+uint32_t record_log_evicted(void) {
+  return evicted;
+}
+
+PROCESS_THREAD(record_log_process, ev, data) {
+  static struct etimer probe_timer;
+  static struct etimer replay_timer;
+
+  PROCESS_BEGIN();
+
+  record_log_init();
+  etimer_set(&probe_timer, HOST_PROBE_INTERVAL);
+
+  /* Owned by this process so that it stays open */
+  host_connection = udp_new(NULL, UIP_HTONS(RECORD_LOG_PORT), NULL);
+  if (host_connection == NULL) {
+    PRINTF("No UDP connection for the record log, records stay in flash\n");
+  }
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+
+    if (ev == PROCESS_EVENT_POLL) {
+      flush_live();
+    }
+
+    if (ev == PROCESS_EVENT_TIMER && data == &probe_timer) {
+      if (host_up && (clock_time_t)(clock_time() - host_last_seen) > HOST_LINK_TIMEOUT) {
+        PRINTF("Host link down, logging records to flash\n");
+        host_up = 0;
+        spill_live();
+        save_cursor();
+      }
+      if ((clock_time_t)(clock_time() - host_last_seen) > HOST_PROBE_INTERVAL) {
+        request_prefix();
+      }
+      etimer_reset(&probe_timer);
+    }
+
+    if (ev == PROCESS_EVENT_POLL && can_send() && replayed_seq < head_seq) {
+      PRINTF("Host link up, replaying %lu records\n", (unsigned long)(head_seq - replayed_seq));
+      etimer_set(&replay_timer, RECORD_LOG_REPLAY_INTERVAL);
+    }
+
+    if (ev == PROCESS_EVENT_TIMER && data == &replay_timer && can_send()) {
+      if (replay_batch()) {
+        etimer_reset(&replay_timer);
+      }
+    }
+  }
+
+  PROCESS_END();
+}
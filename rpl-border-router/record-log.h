@@ -0,0 +1,90 @@
+/**
+ * \file
+ *         Store-and-forward log of ingested sensor records
+ *
+ *         Records are forwarded to the host as soon as they are ingested.
+ *         While the host is unreachable they are appended to a fixed-size
+ *         ring file in flash, evicting the oldest records first, and replayed
+ *         in rate-limited batches once the host reappears.
+ *
+ *         Records travel as UDP datagrams through the SLIP tunnel to the
+ *         host end of the tunnel, the router's prefix with interface id
+ *         RECORD_LOG_HOST_IID (aaaa::1 for "tunslip6 aaaa::1/64"), port
+ *         RECORD_LOG_PORT. A datagram holds 'R' <count> followed by count
+ *         records in their in-memory little-endian layout.
+ */
+
+#ifndef __RECORD_LOG_H__
+#define __RECORD_LOG_H__
+
+#include "contiki.h"
+#include "net/uip.h"
+#include "common.h"
+
+#ifndef RECORD_LOG_CONF_SLOTS
+#define RECORD_LOG_SLOTS 256
+#else /* RECORD_LOG_CONF_SLOTS */
+#define RECORD_LOG_SLOTS RECORD_LOG_CONF_SLOTS
+#endif /* RECORD_LOG_CONF_SLOTS */
+
+#ifndef RECORD_LOG_CONF_PORT
+#define RECORD_LOG_PORT 0xf0b2
+#else /* RECORD_LOG_CONF_PORT */
+#define RECORD_LOG_PORT RECORD_LOG_CONF_PORT
+#endif /* RECORD_LOG_CONF_PORT */
+
+#ifndef RECORD_LOG_CONF_HOST_IID
+#define RECORD_LOG_HOST_IID 1
+#else /* RECORD_LOG_CONF_HOST_IID */
+#define RECORD_LOG_HOST_IID RECORD_LOG_CONF_HOST_IID
+#endif /* RECORD_LOG_CONF_HOST_IID */
+
+/* Records per datagram and the pause between replayed datagrams, which leaves
+ * the SLIP link to live traffic in between. A datagram has to fit into
+ * UIP_BUFSIZE. */
+#ifndef RECORD_LOG_CONF_BATCH
+#define RECORD_LOG_BATCH 2
+#else /* RECORD_LOG_CONF_BATCH */
+#define RECORD_LOG_BATCH RECORD_LOG_CONF_BATCH
+#endif /* RECORD_LOG_CONF_BATCH */
+
+#ifndef RECORD_LOG_CONF_REPLAY_INTERVAL
+#define RECORD_LOG_REPLAY_INTERVAL (CLOCK_SECOND / 4)
+#else /* RECORD_LOG_CONF_REPLAY_INTERVAL */
+#define RECORD_LOG_REPLAY_INTERVAL RECORD_LOG_CONF_REPLAY_INTERVAL
+#endif /* RECORD_LOG_CONF_REPLAY_INTERVAL */
+
+/* Set in the flags of records whose sample carried SENSOR_ID_SEQ */
+#define RECORD_LOG_FLAG_SEQUENCED 0x80
+
+typedef struct {
+  uint32_t seq;
+  uint32_t timestamp;   /* clock_seconds() when the sample was taken */
+  uint16_t epoch;       /* boot counter, makes timestamps comparable */
+  sensor_packet data;
+  uint16_t sample_seq;  /* SENSOR_ID_SEQ of the mote */
+  uint16_t sample_boot; /* boot number of SENSOR_ID_SEQ, 0 if the mote sends none */
+  uint8_t node_iid[8];  /* interface id of the mote's address */
+  uint8_t node_id;      /* the router's id of node_iid, 0 if untracked */
+  uint8_t flags;        /* ANOMALY_FLAG_* of anomaly-filter.h, RECORD_LOG_FLAG_* */
+  uint8_t check;
+} log_record;
+
+PROCESS_NAME(record_log_process);
+
+/* Records are sent to the host on this /64 prefix */
+void record_log_set_prefix(const uip_ipaddr_t *prefix);
+
+/* node_iid is the 8 byte interface id of the mote's address, age the number
+ * of seconds the mote held the sample before sending it */
+void record_log_ingest(uint8_t node_id, const uint8_t *node_iid, const sensor_packet *data,
+                       uint16_t sample_seq, uint16_t sample_boot, uint16_t age, uint8_t flags);
+
+/* Called for every frame received from the host over SLIP */
+void record_log_host_alive(void);
+
+int record_log_host_up(void);
+uint32_t record_log_pending(void);
+uint32_t record_log_evicted(void);
+
+#endif /* __RECORD_LOG_H__ */
@@ -0,0 +1,141 @@
+/**
+ * \file
+ *         Per-node rollups of temperature and light at 1 min, 1 h and 1 day
+ */
+
+#include "contiki.h"
+
+#include <string.h>
+
+#include "border-router.h"
+#include "rollup.h"
+
+typedef struct {
+  rollup_bucket current;
+  rollup_bucket previous;
+} rollup_pair;
+
+typedef struct {
+  uint8_t node_id;
+  rollup_pair pairs[ROLLUP_RESOLUTIONS];
+} node_rollups;
+
+static const uint32_t periods[ROLLUP_RESOLUTIONS] = { 60, 60UL * 60, 60UL * 60 * 24 };
+
+/* One entry per slot of sensor_measurements */
+static node_rollups rollups[MAX_SENSOR_NODES];
+
+static node_rollups *rollups_for(uint8_t node_id, int create) {
+  int i;
+
+  if (node_id == 0) {
+    return NULL;
+  }
+
+  for (i = 0; i < MAX_SENSOR_NODES; ++i) {
+    if (rollups[i].node_id == node_id) {
+      return &rollups[i];
+    }
+  }
+
+  if (!create) {
+    return NULL;
+  }
+
+  for (i = 0; i < MAX_SENSOR_NODES; ++i) {
+    if (rollups[i].node_id == 0) {
+      memset(&rollups[i], 0, sizeof(node_rollups));
+      rollups[i].node_id = node_id;
+      return &rollups[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Moves the pair on to the period starting at start, if that is later than
+ * the current one. Periods that have not begun yet are refused, a bucket in
+ * the future would hold back every sample until the clock caught up. */
+static void advance(rollup_pair *pair, uint32_t start, uint32_t period) {
+  if (start <= pair->current.start || start > clock_seconds()) {
+    return;
+  }
+
+  if (pair->current.start + period == start) {
+    memcpy(&pair->previous, &pair->current, sizeof(rollup_bucket));
+  } else {
+    /* Whole periods went by without samples */
+    memset(&pair->previous, 0, sizeof(rollup_bucket));
+    pair->previous.start = start - period;
+  }
+
+  memset(&pair->current, 0, sizeof(rollup_bucket));
+  pair->current.start = start;
+}
+
+static void add_sample(rollup_bucket *b, int16_t temperature, uint16_t light) {
+  if (b->count == 0 || temperature < b->temp_min) {
+    b->temp_min = temperature;
+  }
+  if (b->count == 0 || temperature > b->temp_max) {
+    b->temp_max = temperature;
+  }
+  if (b->count == 0 || light < b->light_min) {
+    b->light_min = light;
+  }
+  if (b->count == 0 || light > b->light_max) {
+    b->light_max = light;
+  }
+  b->temp_sum += temperature;
+  b->light_sum += light;
+  ++b->count;
+}
+
+void rollup_add(uint8_t node_id, uint32_t timestamp, int16_t temperature, uint16_t light) {
+  node_rollups *r;
+  rollup_pair *pair;
+  uint32_t start;
+  uint8_t i;
+
+  r = rollups_for(node_id, 1);
+  if (r == NULL) {
+    return;
+  }
+
+  for (i = 0; i < ROLLUP_RESOLUTIONS; ++i) {
+    pair = &r->pairs[i];
+    start = timestamp - timestamp % periods[i];
+    advance(pair, start, periods[i]);
+
+    if (start == pair->current.start) {
+      add_sample(&pair->current, temperature, light);
+    } else if (start == pair->previous.start) {
+      add_sample(&pair->previous, temperature, light);
+    }
+  }
+}
+
+int rollup_get(uint8_t node_id, uint8_t resolution, rollup_bucket *current, rollup_bucket *previous) {
+  node_rollups *r;
+  rollup_pair *pair;
+  uint32_t now;
+
+  r = rollups_for(node_id, 0);
+  if (r == NULL || resolution >= ROLLUP_RESOLUTIONS) {
+    return 0;
+  }
+
+  /* Periods that ended without a new sample are rolled over here */
+  pair = &r->pairs[resolution];
+  now = clock_seconds();
+  advance(pair, now - now % periods[resolution], periods[resolution]);
+
+  memcpy(current, &pair->current, sizeof(rollup_bucket));
+  memcpy(previous, &pair->previous, sizeof(rollup_bucket));
+
+  return 1;
+}
+
+uint32_t rollup_period(uint8_t resolution) {
+  return periods[resolution];
+}
@@ -0,0 +1,41 @@
+/**
+ * \file
+ *         Per-node rollups of temperature and light at 1 min, 1 h and 1 day
+ *
+ *         Every resolution keeps the bucket being filled and the one before
+ *         it. Buckets are aligned to multiples of their period in seconds
+ *         since boot. A sample goes into the bucket of the time it was taken,
+ *         so backlogged samples still land in the previous bucket; older ones
+ *         only count at the coarser resolutions.
+ */
+
+#ifndef __ROLLUP_H__
+#define __ROLLUP_H__
+
+#include "contiki.h"
+
+#define ROLLUP_MINUTE      0
+#define ROLLUP_HOUR        1
+#define ROLLUP_DAY         2
+#define ROLLUP_RESOLUTIONS 3
+
+typedef struct {
+  uint32_t start;       /* clock_seconds() at the start of the period */
+  uint16_t count;
+  int32_t temp_sum;     /* 1/16 degC */
+  int16_t temp_min;
+  int16_t temp_max;
+  uint32_t light_sum;
+  uint16_t light_min;
+  uint16_t light_max;
+} rollup_bucket;
+
+void rollup_add(uint8_t node_id, uint32_t timestamp, int16_t temperature, uint16_t light);
+
+/* Copies the bucket being filled and the last complete one as of now,
+ * returns 0 if the node has no rollups. Empty buckets have count 0. */
+int rollup_get(uint8_t node_id, uint8_t resolution, rollup_bucket *current, rollup_bucket *previous);
+
+uint32_t rollup_period(uint8_t resolution);
+
+#endif /* __ROLLUP_H__ */
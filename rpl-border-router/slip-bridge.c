@@ -50,6 +50,7 @@
 #include "net/uip-debug.h"
 
 void set_prefix_64(uip_ipaddr_t *);
+void record_log_host_alive(void);
 
 static uip_ipaddr_t last_sender;
 /*---------------------------------------------------------------------------*/
@@ -57,6 +58,7 @@ static void
 slip_input_callback(void)
 {
  // PRINTF("SIN: %u\n", uip_len);
+  record_log_host_alive();
   if(uip_buf[0] == '!') {
     PRINTF("Got configuration message of type %c\n", uip_buf[1]);
     uip_len = 0;
@@ -1,2 +1,13 @@
+#include "lowpan-conf.h"
+
 #define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 4
 #define NETSTACK_CONF_RDC contikimac_driver
+
+/* ContikiMAC learns the wake-up phase of the parent from its ACKs and holds
+ * unicasts until just before the parent wakes up */
+#define CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION 1
+
+/* Every border router of a deployment roots its own DODAG in the same RPL
+ * instance; the mote keeps track of one DODAG per router it hears so it can
+ * move over when its root fails */
+#define RPL_CONF_MAX_DAG_PER_INSTANCE 3
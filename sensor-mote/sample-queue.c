@@ -0,0 +1,148 @@
+#include "sample-queue.h"
+
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+
+#include <string.h>
+
+#define SPILL_FILENAME "backlog"
+
+typedef struct {
+  unsigned long sampled_at;   /* clock_seconds() when the sample was taken */
+  uint8_t len;
+  uint8_t readings[SENSOR_READINGS_MAX_LEN];
+} queued_sample;
+
+static queued_sample ring[SAMPLE_QUEUE_RAM_SLOTS];
+static uint8_t ring_head;
+static uint8_t ring_count;
+
+/* Spilled samples form a ring of SAMPLE_QUEUE_FLASH_SLOTS slots in the file */
+static uint16_t spill_first;   /* slot of the oldest spilled sample */
+static uint16_t spill_count;
+static uint16_t dropped;
+
+/* When the file is full the new sample takes the slot of the oldest one,
+ * which is the oldest sample in the whole queue */
+static int spill(const queued_sample *sample) {
+  uint16_t slot;
+  int fd;
+  int len;
+
+  if (spill_count == 0) {
+    cfs_coffee_reserve(SPILL_FILENAME, SAMPLE_QUEUE_FLASH_SLOTS * sizeof(queued_sample));
+  }
+
+  fd = cfs_open(SPILL_FILENAME, CFS_READ | CFS_WRITE);
+  if (fd < 0) {
+    return 0;
+  }
+  slot = (spill_first + spill_count) % SAMPLE_QUEUE_FLASH_SLOTS;
+  cfs_seek(fd, (cfs_offset_t)slot * sizeof(queued_sample), CFS_SEEK_SET);
+  len = cfs_write(fd, sample, sizeof(queued_sample));
+  cfs_close(fd);
+
+  if (len != sizeof(queued_sample)) {
+    return 0;
+  }
+
+  if (spill_count == SAMPLE_QUEUE_FLASH_SLOTS) {
+    spill_first = (spill_first + 1) % SAMPLE_QUEUE_FLASH_SLOTS;
+    ++dropped;
+  } else {
+    ++spill_count;
+  }
+
+  return 1;
+}
+
+static int unspill(queued_sample *sample) {
+  int fd;
+  int len;
+
+  fd = cfs_open(SPILL_FILENAME, CFS_READ);
+  if (fd < 0) {
+    len = 0;
+  } else {
+    cfs_seek(fd, (cfs_offset_t)spill_first * sizeof(queued_sample), CFS_SEEK_SET);
+    len = cfs_read(fd, sample, sizeof(queued_sample));
+    cfs_close(fd);
+  }
+
+  spill_first = (spill_first + 1) % SAMPLE_QUEUE_FLASH_SLOTS;
+  --spill_count;
+  if (spill_count == 0) {
+    cfs_remove(SPILL_FILENAME);
+    spill_first = 0;
+  }
+
+  return len == sizeof(queued_sample);
+}
+
+void sample_queue_init(void) {
+  /* The read position is not persisted, so a backlog from before a reboot is unusable */
+  cfs_remove(SPILL_FILENAME);
+  ring_head = 0;
+  ring_count = 0;
+  spill_first = 0;
+  spill_count = 0;
+  dropped = 0;
+}
+
+void sample_queue_push(const uint8_t *readings, uint8_t len) {
+  queued_sample *slot;
+
+  if (ring_count == SAMPLE_QUEUE_RAM_SLOTS) {
+    /* Make room by moving the oldest RAM sample to flash, or losing it when
+     * flash cannot be written */
+    if (!spill(&ring[ring_head])) {
+      ++dropped;
+    }
+    ring_head = (ring_head + 1) % SAMPLE_QUEUE_RAM_SLOTS;
+    --ring_count;
+  }
+
+  slot = &ring[(ring_head + ring_count) % SAMPLE_QUEUE_RAM_SLOTS];
+  slot->sampled_at = clock_seconds();
+  slot->len = len < SENSOR_READINGS_MAX_LEN ? len : SENSOR_READINGS_MAX_LEN;
+  memcpy(slot->readings, readings, slot->len);
+  ++ring_count;
+}
+
+int sample_queue_pop(sample_entry *entry) {
+  queued_sample sample;
+  int found;
+  unsigned long age;
+
+  found = 0;
+  while (!found && spill_count > 0) {
+    found = unspill(&sample);
+    if (!found) {
+      ++dropped;
+    }
+  }
+
+  if (!found) {
+    if (ring_count == 0) {
+      return 0;
+    }
+    memcpy(&sample, &ring[ring_head], sizeof(queued_sample));
+    ring_head = (ring_head + 1) % SAMPLE_QUEUE_RAM_SLOTS;
+    --ring_count;
+  }
+
+  age = clock_seconds() - sample.sampled_at;
+  entry->age = age > 0xffff ? 0xffff : age;
+  entry->len = sample.len;
+  memcpy(entry->readings, sample.readings, sample.len);
+
+  return 1;
+}
+
+uint16_t sample_queue_length(void) {
+  return ring_count + spill_count;
+}
+
+uint16_t sample_queue_dropped(void) {
+  return dropped;
+}
@@ -0,0 +1,38 @@
+#ifndef __SAMPLE_QUEUE_H__
+  #define __SAMPLE_QUEUE_H__
+
+  #include "contiki.h"
+  #include "common.h"
+
+  /* Samples taken while the mote has no route to the sink are kept in a small
+   * RAM ring. When the ring fills up its oldest entries spill into a ring of
+   * slots in a flash file, which always holds older samples than the RAM ring.
+   * When both are full the oldest sample in flash is dropped. If flash cannot
+   * be written, the oldest RAM sample is dropped instead. */
+  #ifndef SAMPLE_QUEUE_CONF_RAM_SLOTS
+    #define SAMPLE_QUEUE_RAM_SLOTS 8
+  #else
+    #define SAMPLE_QUEUE_RAM_SLOTS SAMPLE_QUEUE_CONF_RAM_SLOTS
+  #endif
+
+  #ifndef SAMPLE_QUEUE_CONF_FLASH_SLOTS
+    #define SAMPLE_QUEUE_FLASH_SLOTS 360
+  #else
+    #define SAMPLE_QUEUE_FLASH_SLOTS SAMPLE_QUEUE_CONF_FLASH_SLOTS
+  #endif
+
+  typedef struct {
+    uint16_t age;   /* seconds since the sample was taken */
+    uint8_t len;
+    uint8_t readings[SENSOR_READINGS_MAX_LEN];
+  } sample_entry;
+
+  void sample_queue_init(void);
+  void sample_queue_push(const uint8_t *readings, uint8_t len);
+
+  /* Removes the oldest sample, returns 0 if the queue is empty */
+  int sample_queue_pop(sample_entry *entry);
+
+  uint16_t sample_queue_length(void);
+  uint16_t sample_queue_dropped(void);
+#endif
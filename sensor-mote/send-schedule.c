@@ -0,0 +1,75 @@
+#include "send-schedule.h"
+
+#include "lib/random.h"
+#include "net/rime/rimeaddr.h"
+
+#include "common.h"
+
+static struct ctimer timer;
+static clock_time_t period;
+static clock_time_t period_start;
+static clock_time_t offset;
+static void (*callback)(void *);
+
+static void fire(void *ptr);
+
+/* Consecutive node ids get consecutive slots, so up to period / slot motes
+ * never share one */
+static clock_time_t node_offset(void) {
+  #if SEND_SCHEDULE_SPREAD
+    uint16_t slots;
+    uint16_t id;
+
+    slots = period / SEND_SCHEDULE_SLOT;
+    id = (rimeaddr_node_addr.u8[RIMEADDR_SIZE - 2] << 8) | rimeaddr_node_addr.u8[RIMEADDR_SIZE - 1];
+    return slots > 0 ? (id % slots) * SEND_SCHEDULE_SLOT : 0;
+  #else
+    return 0;
+  #endif
+}
+
+/* Time of the send within its period */
+static clock_time_t send_time(void) {
+  #if SEND_SCHEDULE_SPREAD
+    return offset + random_rand() % SEND_SCHEDULE_SLOT;
+  #else
+    return offset;
+  #endif
+}
+
+/* Times are kept relative to the start of the period, so the jitter of one
+ * send does not shift the following ones. The next send goes into the first
+ * following period whose send time is still ahead: a late callback skips the
+ * periods it missed instead of catching up on them back to back. */
+static void schedule_next(void) {
+  clock_time_t at;
+  clock_time_t start;
+  clock_time_t elapsed;
+
+  at = send_time();
+  elapsed = clock_time() - period_start;
+
+  start = period;
+  if (start + at <= elapsed) {
+    start += ((elapsed - start - at) / period + 1) * period;
+    PRINTF("Send schedule late, skipping %u periods\n", start / period - 1);
+  }
+
+  period_start += start;
+  ctimer_set(&timer, start + at - elapsed, fire, NULL);
+}
+
+static void fire(void *ptr) {
+  schedule_next();
+  callback(NULL);
+}
+
+void send_schedule_start(clock_time_t send_period, void (*f)(void *)) {
+  period = send_period;
+  callback = f;
+  period_start = clock_time();
+  offset = node_offset();
+
+  PRINTF("Sending every %u ticks at offset %u\n", period, offset);
+  ctimer_set(&timer, send_time(), fire, NULL);
+}
@@ -0,0 +1,26 @@
+#ifndef __SEND_SCHEDULE_H__
+  #define __SEND_SCHEDULE_H__
+
+  #include "contiki.h"
+  #include "net/netstack.h"
+
+  /* The send period is divided into slots of one ContikiMAC wake-up interval.
+   * Each mote sends once per period in the slot given by its link address, at
+   * a random point within that slot, so neighbours sharing a parent reach it
+   * in different wake-ups instead of all at once. */
+  #ifndef SEND_SCHEDULE_CONF_SLOT
+    #define SEND_SCHEDULE_SLOT (CLOCK_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+  #else
+    #define SEND_SCHEDULE_SLOT SEND_SCHEDULE_CONF_SLOT
+  #endif
+
+  /* 0 makes every mote send at the start of its period, for comparison runs */
+  #ifndef SEND_SCHEDULE_CONF_SPREAD
+    #define SEND_SCHEDULE_SPREAD 1
+  #else
+    #define SEND_SCHEDULE_SPREAD SEND_SCHEDULE_CONF_SPREAD
+  #endif
+
+  /* Calls f once per period from now on, in the context of the calling process */
+  void send_schedule_start(clock_time_t period, void (*f)(void *));
+#endif
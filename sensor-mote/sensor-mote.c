@@ -2,45 +2,134 @@
 
 static struct uip_udp_conn *udp_server_connection;
 static uip_ipaddr_t server_address;
+static struct ctimer drain_timer;
+
+/* A queued sample that did not fit into the previous batch opens the next one */
+static sample_entry drain_carry;
+static uint8_t drain_carry_pending;
 
 PROCESS(sensor_mote_process, "Sensor mote process");
 AUTOSTART_PROCESSES(&sensor_mote_process);
 
-static temp_t temperature_read(void) {
-  temp_t temp;
-  int16_t raw;
-  uint16_t absraw;
-  int16_t sign;
+/* The sink is the root of the DODAG the mote currently belongs to. With
+ * several border routers RPL moves the mote to another DODAG when its root
+ * fails, and the samples follow it there. */
+static int has_route(void) {
+  rpl_dag_t *dag;
 
-  sign = 1;
-  raw = tmp102_read_temp_raw();
-  absraw = raw;
+  dag = rpl_get_any_dag();
+  if (dag == NULL || dag->preferred_parent == NULL) {
+    return 0;
+  }
 
-  /* Perform 2C's if sensor returned negative data */
-  if (raw < 0) {
-    absraw = (raw ^ 0xFFFF) + 1;
-    sign = -1;
+  if (!uip_ipaddr_cmp(&server_address, &dag->dag_id)) {
+    uip_ipaddr_copy(&server_address, &dag->dag_id);
+    PRINTF("Sink is now ");
+    PRINT6ADDR(&server_address);
+    PRINTF("\n");
   }
+  return 1;
+}
 
-  temp.tempint = (absraw >> 8) * sign;
-  /* Info in 1/10000 of degree */
-  temp.tempfrac = ((absraw >> 4) % 16) * 625;
-  temp.minus = ((temp.tempint == 0) & (sign == -1)) ? '-' : ' ';
+/* sicslowpan leaves the compressed packet in the packetbuf until the MAC
+ * gets to send it, which shows what the headers cost on air and whether the
+ * UDP header was compressed (see the transport profiles in common.h) */
+static void report_headers(uint8_t payload_len) {
+  uint8_t iphc;
+  uint8_t dispatch;
+
+  iphc = *(uint8_t *)packetbuf_dataptr();
+  dispatch = iphc & 0xf8;
+  if (dispatch == SICSLOWPAN_DISPATCH_FRAG1 || dispatch == SICSLOWPAN_DISPATCH_FRAGN) {
+    printf("Datagram with %u bytes of payload was fragmented\n", payload_len);
+    return;
+  }
 
-  return temp;
+  PRINTF("Headers: %u bytes uncompressed, %u on air, UDP %s; frame %u of %u bytes\n",
+    LOWPAN_HDR_UNCOMPRESSED, packetbuf_datalen() - payload_len,
+    (iphc & SICSLOWPAN_IPHC_NH_C) ? "compressed" : "inline",
+    packetbuf_datalen(), LOWPAN_FRAME_ROOM);
 }
 
-static void send_data(void) {
-  uint16_t light_intensity;
-  temp_t temperature;
+static void send_frame(const uint8_t *frame, uint8_t len) {
+  uip_udp_packet_sendto(udp_server_connection, frame, len, &server_address, UIP_HTONS(UDP_SERVER_PORT));
+  report_headers(len);
+}
 
-  light_intensity = light_ziglet_read();
-  temperature = temperature_read();
+static void send_sample(const uint8_t *readings, uint8_t len) {
+  uint8_t frame[1 + SENSOR_READINGS_MAX_LEN];
 
-  PRINTF("Sending data: temperature: %d, light: %d\n", temperature, light_intensity);
+  frame[0] = SENSOR_FRAME_SAMPLE;
+  memcpy(&frame[1], readings, len);
+  send_frame(frame, 1 + len);
+}
+
+static uint16_t backlog_length(void) {
+  return sample_queue_length() + drain_carry_pending;
+}
 
-  sensor_packet data = { temperature, light_intensity };
-  uip_udp_packet_sendto(udp_server_connection, (void *)&data, sizeof(sensor_packet), &server_address, UIP_HTONS(UDP_SERVER_PORT));
+static void drain_backlog(void *ptr) {
+  uint8_t frame[DRAIN_FRAME_LEN];
+  uint8_t pos;
+  uint8_t count;
+
+  if (!has_route()) {
+    PRINTF("Route lost, %u samples stay queued\n", backlog_length());
+    return;
+  }
+
+  pos = 2;
+  count = 0;
+  while (drain_carry_pending || sample_queue_pop(&drain_carry)) {
+    if (pos + SENSOR_BATCH_ENTRY_HDR_LEN + drain_carry.len > sizeof(frame)) {
+      drain_carry_pending = 1;
+      break;
+    }
+    frame[pos] = drain_carry.age & 0xff;
+    frame[pos + 1] = drain_carry.age >> 8;
+    frame[pos + 2] = drain_carry.len;
+    memcpy(&frame[pos + SENSOR_BATCH_ENTRY_HDR_LEN], drain_carry.readings, drain_carry.len);
+    pos += SENSOR_BATCH_ENTRY_HDR_LEN + drain_carry.len;
+    drain_carry_pending = 0;
+    ++count;
+  }
+  if (count == 0) {
+    return;
+  }
+
+  frame[0] = SENSOR_FRAME_BATCH;
+  frame[1] = count;
+  send_frame(frame, pos);
+  PRINTF("Sent %u queued samples, %u left\n", count, backlog_length());
+
+  if (backlog_length() > 0) {
+    ctimer_set(&drain_timer, DRAIN_INTERVAL / 2 + random_rand() % DRAIN_INTERVAL, drain_backlog, NULL);
+  }
+}
+
+static void send_data(void *ptr) {
+  uint8_t readings[SENSOR_READINGS_MAX_LEN];
+  uint8_t len;
+
+  len = sensor_registry_sample(readings, sizeof(readings));
+  if (len == 0) {
+    return;
+  }
+
+  PRINTF("Sending %u bytes of readings\n", len);
+
+  /* Queue behind any backlog so the sink receives samples in order */
+  if (!has_route() || backlog_length() > 0) {
+    sample_queue_push(readings, len);
+    PRINTF("Queued sample, backlog %u, dropped %u\n", backlog_length(), sample_queue_dropped());
+
+    if (has_route() && ctimer_expired(&drain_timer)) {
+      /* A random start keeps motes that rejoin together from draining in lockstep */
+      ctimer_set(&drain_timer, random_rand() % DRAIN_INTERVAL, drain_backlog, NULL);
+    }
+  } else {
+    send_sample(readings, len);
+  }
 
   #if DEBUG_ENABLED
     static float energy_consumed;
@@ -53,52 +142,35 @@ static void send_data(void) {
   #endif
 }
 
-static void configure_ipv6_addresses(void) {
-  uip_ipaddr_t ipaddr;
-
-  /* Set client address according to client MAC */
-  uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
-  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
-  uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
-
-  /* Set server address according to its MAC */
-  uip_ip6addr(&server_address, 0xaaaa, 0, 0, 0, 0xc30c, 0, 0, 0);
-}
-
+/* The mote's own global address is autoconfigured by RPL from the prefix in
+ * the DIOs, so it always matches the prefix of the DODAG it joined.
+ * The connection has no fixed peer, every datagram is addressed to the sink
+ * found by has_route(). */
 static void establish_udp_connection(void) {
   do {
     PRINTF("Establishing UDP connection\n");
-    udp_server_connection = udp_new(&server_address, UIP_HTONS(UDP_SERVER_PORT), NULL);
+    udp_server_connection = udp_new(NULL, UIP_HTONS(UDP_SERVER_PORT), NULL);
   } while (udp_server_connection == NULL);
   udp_bind(udp_server_connection, UIP_HTONS(UDP_CLIENT_PORT));
 
-  PRINTF("UDP connection established with: ");
-  PRINT6ADDR(&udp_server_connection->ripaddr);
-  PRINTF("on local/remote port %u/%u\n", UIP_HTONS(udp_server_connection->lport), UIP_HTONS(udp_server_connection->rport));
+  PRINTF("UDP connection established on local/remote port %u/%u\n", UIP_HTONS(udp_server_connection->lport), UIP_HTONS(udp_server_connection->rport));
 }
 
 PROCESS_THREAD(sensor_mote_process, ev, data) {
-  static struct etimer send_timer;
-  static struct ctimer backoff_timer;
-
   PROCESS_BEGIN();
   PROCESS_PAUSE();
 
-  tmp102_init();
-  light_ziglet_init();
+  sensor_registry_init();
+  sample_queue_init();
 
-  configure_ipv6_addresses();
   establish_udp_connection();
 
-  etimer_set(&send_timer, SEND_PERIOD);
+  /* Sends run from the schedule's ctimer, the process only has to stay alive
+   * for the UDP connection to stay open */
+  send_schedule_start(SEND_PERIOD, send_data);
 
   while(1) {
     PROCESS_YIELD();
-
-    if (etimer_expired(&send_timer)) {
-      etimer_reset(&send_timer);
-      ctimer_set(&backoff_timer, SEND_PERIOD, send_data, NULL);
-    }
   }
 
   PROCESS_END();
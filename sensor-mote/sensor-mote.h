@@ -2,21 +2,30 @@
   #define __SENSOR_MOTE_H__
 
   #include "dev/i2cmaster.h"
-  #include "dev/light-ziglet.h"
-  #include "dev/tmp102.h"
 
   #include "dev/cc2420.h"
   #include "lib/random.h"
   #include "net/uip.h"
   #include "net/uip-ds6.h"
   #include "net/uip-udp-packet.h"
+  #include "net/packetbuf.h"
+  #include "net/sicslowpan.h"
+  #include "net/rpl/rpl.h"
 
   #include <stdio.h>
   #include <string.h>
 
   #include "common.h"
+  #include "sample-queue.h"
+  #include "sensor-registry.h"
+  #include "send-schedule.h"
 
   #define PERIOD          10
   #define SEND_PERIOD     (PERIOD * CLOCK_SECOND)
   #define MAX_PAYLOAD_LEN 30
+
+  /* Backlog drain pacing once the mote rejoins the DAG, a batch carries as
+   * many queued samples as fit in one unfragmented frame */
+  #define DRAIN_FRAME_LEN SENSOR_FRAME_MAX_LEN
+  #define DRAIN_INTERVAL  (2 * CLOCK_SECOND)
 #endif
@@ -0,0 +1,181 @@
+#include "sensor-registry.h"
+
+#include "dev/adxl345.h"
+#include "dev/battery-sensor.h"
+#include "dev/light-ziglet.h"
+#include "dev/tmp102.h"
+#include "dev/z1-phidgets.h"
+#include "cfs/cfs.h"
+#include "lib/random.h"
+
+#include "tx-power.h"
+
+#include <string.h>
+
+#define MAX_VALUE_LEN 6
+
+#define BOOT_FILENAME "boot"
+
+static void temperature_init(void) {
+  tmp102_init();
+}
+
+static uint8_t temperature_read(uint8_t *value) {
+  /* The 12 bit reading is left aligned, the low nibble carries no data */
+  int16_t sixteenths = tmp102_read_temp_raw() / 16;
+
+  memcpy(value, &sixteenths, sizeof(sixteenths));
+  return sizeof(sixteenths);
+}
+
+static void light_init(void) {
+  light_ziglet_init();
+}
+
+static uint8_t light_read(uint8_t *value) {
+  uint16_t light = light_ziglet_read();
+
+  memcpy(value, &light, sizeof(light));
+  return sizeof(light);
+}
+
+static void accel_init(void) {
+  accm_init();
+}
+
+static uint8_t accel_read(uint8_t *value) {
+  int16_t axes[3];
+
+  axes[0] = accm_read_axis(X_AXIS);
+  axes[1] = accm_read_axis(Y_AXIS);
+  axes[2] = accm_read_axis(Z_AXIS);
+
+  memcpy(value, axes, sizeof(axes));
+  return sizeof(axes);
+}
+
+static void battery_init(void) {
+  SENSORS_ACTIVATE(battery_sensor);
+}
+
+static uint8_t battery_read(uint8_t *value) {
+  /* 12 bit ADC against 2.5 V, measured through a divide-by-two */
+  uint16_t millivolts = (uint32_t)battery_sensor.value(0) * 5000 / 4096;
+
+  memcpy(value, &millivolts, sizeof(millivolts));
+  return sizeof(millivolts);
+}
+
+static void adc_init(void) {
+  SENSORS_ACTIVATE(phidgets);
+}
+
+static uint8_t adc_read(uint8_t *value) {
+  uint16_t channels[2];
+
+  channels[0] = phidgets.value(PHIDGET5V_1);
+  channels[1] = phidgets.value(PHIDGET3V_2);
+
+  memcpy(value, channels, sizeof(channels));
+  return sizeof(channels);
+}
+
+/* Lets the host drop copies of a sample that reached it through more than
+ * one border router. The boot number, counted in flash, keeps the counts of
+ * different boots apart; the random generator is seeded from the node address
+ * and would start over at the same number after every reboot. */
+static uint16_t sample_seq;
+static uint16_t boot;
+
+static void seq_init(void) {
+  int fd;
+
+  boot = 0;
+  fd = cfs_open(BOOT_FILENAME, CFS_READ);
+  if (fd >= 0) {
+    cfs_read(fd, &boot, sizeof(boot));
+    cfs_close(fd);
+  }
+  ++boot;
+
+  fd = cfs_open(BOOT_FILENAME, CFS_WRITE);
+  if (fd >= 0) {
+    cfs_write(fd, &boot, sizeof(boot));
+    cfs_close(fd);
+  } else {
+    boot = random_rand();
+  }
+
+  /* 0 stands for motes that do not send a boot number */
+  if (boot == 0) {
+    boot = 1;
+  }
+  sample_seq = 0;
+}
+
+static uint8_t seq_read(uint8_t *value) {
+  ++sample_seq;
+  memcpy(value, &sample_seq, sizeof(sample_seq));
+  memcpy(value + sizeof(sample_seq), &boot, sizeof(boot));
+  return sizeof(sample_seq) + sizeof(boot);
+}
+
+static uint8_t link_read(uint8_t *value) {
+  value[0] = (uint8_t)tx_power_dbm();
+  value[1] = tx_power_prr();
+  return 2;
+}
+
+/* Add new sensors here, the send stage packs whatever is due into one frame */
+static const sensor_entry sensors[] = {
+  { SENSOR_ID_SEQ,         1,  seq_init,         seq_read },
+  { SENSOR_ID_TEMPERATURE, 1,  temperature_init, temperature_read },
+  { SENSOR_ID_LIGHT,       1,  light_init,       light_read },
+  { SENSOR_ID_ACCEL,       3,  accel_init,       accel_read },
+  { SENSOR_ID_ADC,         6,  adc_init,         adc_read },
+  { SENSOR_ID_BATTERY,     60, battery_init,     battery_read },
+  { SENSOR_ID_LINK,        6,  tx_power_init,    link_read },
+};
+
+#define SENSOR_COUNT (sizeof(sensors) / sizeof(sensors[0]))
+
+static uint8_t countdown[SENSOR_COUNT];
+
+void sensor_registry_init(void) {
+  uint8_t i;
+
+  /* Everything is sampled in the first period */
+  for (i = 0; i < SENSOR_COUNT; ++i) {
+    if (sensors[i].init != NULL) {
+      sensors[i].init();
+    }
+    countdown[i] = 1;
+  }
+}
+
+uint8_t sensor_registry_sample(uint8_t *buf, uint8_t size) {
+  uint8_t value[MAX_VALUE_LEN];
+  uint8_t len;
+  uint8_t pos;
+  uint8_t i;
+
+  pos = 0;
+  for (i = 0; i < SENSOR_COUNT; ++i) {
+    if (--countdown[i] > 0) {
+      continue;
+    }
+    countdown[i] = sensors[i].every;
+
+    len = sensors[i].read(value);
+    if (len == 0 || pos + SENSOR_READING_HDR_LEN + len > size) {
+      continue;
+    }
+
+    buf[pos] = sensors[i].id;
+    buf[pos + 1] = len;
+    memcpy(&buf[pos + SENSOR_READING_HDR_LEN], value, len);
+    pos += SENSOR_READING_HDR_LEN + len;
+  }
+
+  return pos;
+}
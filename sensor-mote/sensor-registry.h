@@ -0,0 +1,21 @@
+#ifndef __SENSOR_REGISTRY_H__
+  #define __SENSOR_REGISTRY_H__
+
+  #include "contiki.h"
+  #include "common.h"
+
+  /* A sensor is sampled every `every` send periods. read() writes the value
+   * and returns its length, 0 if there is nothing to report. */
+  typedef struct {
+    uint8_t id;
+    uint8_t every;
+    void (*init)(void);
+    uint8_t (*read)(uint8_t *value);
+  } sensor_entry;
+
+  void sensor_registry_init(void);
+
+  /* Appends the readings of every sensor due in this period, returns the
+   * number of bytes written */
+  uint8_t sensor_registry_sample(uint8_t *buf, uint8_t size);
+#endif
@@ -0,0 +1,160 @@
+#include "tx-power.h"
+
+#include "dev/cc2420.h"
+#include "net/mac/mac.h"
+#include "net/packetbuf.h"
+#include "net/rime.h"
+#include "net/rpl/rpl.h"
+
+#include <string.h>
+
+#include "common.h"
+
+/* Unicasts to the parent per PRR evaluation, and losses in a row that raise
+ * the power without waiting for the window to end */
+#define WINDOW           16
+#define LOSS_STREAK      3
+
+/* The parent must still hear us this far above the CC2420 sensitivity of
+ * about -95 dBm after stepping down */
+#define RSSI_FLOOR       (-87)
+#define CC2420_RSSI_OFFSET (-45)
+
+#define LEVELS (sizeof(levels) / sizeof(levels[0]))
+
+typedef struct {
+  uint8_t reg;
+  int8_t dbm;
+} power_level;
+
+/* CC2420 PA_LEVEL settings, lowest first */
+static const power_level levels[] = {
+  {  3, -25 },
+  {  7, -15 },
+  { 11, -10 },
+  { 15,  -7 },
+  { 19,  -5 },
+  { 23,  -3 },
+  { 27,  -1 },
+  { 31,   0 },
+};
+
+static uint8_t level;
+static uint8_t sent;
+static uint8_t acked;
+static uint8_t loss_streak;
+static uint8_t prr;
+static int16_t rssi_avg;        /* dBm, EWMA scaled by 8 */
+static uint8_t rssi_valid;
+static uip_ipaddr_t parent_addr;
+
+static void set_level(uint8_t new_level) {
+  if (new_level >= LEVELS) {
+    new_level = LEVELS - 1;
+  }
+  if (new_level != level) {
+    PRINTF("TX power %d dBm -> %d dBm\n", levels[level].dbm, levels[new_level].dbm);
+    level = new_level;
+    cc2420_set_txpower(levels[level].reg);
+  }
+}
+
+static void reset_window(void) {
+  sent = 0;
+  acked = 0;
+  loss_streak = 0;
+}
+
+/* The link-local address of a parent embeds its MAC with the U/L bit flipped */
+static int is_parent(const rimeaddr_t *addr) {
+  rpl_dag_t *dag;
+  const uip_ipaddr_t *ip;
+
+  dag = rpl_get_any_dag();
+  if (dag == NULL || dag->preferred_parent == NULL) {
+    return 0;
+  }
+  ip = &dag->preferred_parent->addr;
+
+  /* A new parent may be further away, start over from full power */
+  if (!uip_ipaddr_cmp(ip, &parent_addr)) {
+    uip_ipaddr_copy(&parent_addr, ip);
+    rssi_valid = 0;
+    prr = TX_POWER_PRR_UNKNOWN;
+    reset_window();
+    set_level(LEVELS - 1);
+  }
+
+  return addr->u8[0] == (ip->u8[8] ^ 0x02) && memcmp(&addr->u8[1], &ip->u8[9], 7) == 0;
+}
+
+static void packet_input(void) {
+  int16_t rssi;
+
+  if (!is_parent(packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+    return;
+  }
+
+  rssi = (int8_t)packetbuf_attr(PACKETBUF_ATTR_RSSI) + CC2420_RSSI_OFFSET;
+  if (!rssi_valid) {
+    rssi_avg = rssi * 8;
+    rssi_valid = 1;
+  } else {
+    rssi_avg += rssi - rssi_avg / 8;
+  }
+}
+
+static void evaluate_window(void) {
+  prr = (uint16_t)acked * 100 / sent;
+
+  if (prr < TX_POWER_TARGET_PRR) {
+    set_level(level + 2);
+  } else if (level > 0 && rssi_valid &&
+             rssi_avg / 8 + levels[level - 1].dbm > RSSI_FLOOR) {
+    set_level(level - 1);
+  }
+
+  reset_window();
+}
+
+static void packet_output(int mac_status) {
+  /* Broadcasts carry no ACK and collisions say nothing about the link */
+  if (mac_status == MAC_TX_COLLISION ||
+      !is_parent(packetbuf_addr(PACKETBUF_ADDR_RECEIVER))) {
+    return;
+  }
+
+  ++sent;
+  if (mac_status == MAC_TX_OK) {
+    ++acked;
+    loss_streak = 0;
+  } else if (++loss_streak >= LOSS_STREAK) {
+    set_level(level + 1);
+    prr = (uint16_t)acked * 100 / sent;
+    reset_window();
+    return;
+  }
+
+  if (sent >= WINDOW) {
+    evaluate_window();
+  }
+}
+
+RIME_SNIFFER(tx_power_sniffer, packet_input, packet_output);
+
+void tx_power_init(void) {
+  level = LEVELS - 1;
+  cc2420_set_txpower(levels[level].reg);
+  prr = TX_POWER_PRR_UNKNOWN;
+  memset(&parent_addr, 0, sizeof(parent_addr));
+  reset_window();
+  rime_sniffer_add(&tx_power_sniffer);
+}
+
+int8_t tx_power_dbm(void) {
+  return levels[level].dbm;
+}
+
+uint8_t tx_power_prr(void) {
+  return prr;
+}
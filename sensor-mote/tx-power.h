@@ -0,0 +1,24 @@
+#ifndef __TX_POWER_H__
+  #define __TX_POWER_H__
+
+  #include "contiki.h"
+
+  /* Closed-loop CC2420 output power control towards the preferred RPL parent.
+   * Unicast ACK outcomes give the link PRR, packets overheard from the parent
+   * give the RSSI used to judge whether the next lower level still has margin. */
+  #ifndef TX_POWER_CONF_TARGET_PRR
+    #define TX_POWER_TARGET_PRR 90
+  #else
+    #define TX_POWER_TARGET_PRR TX_POWER_CONF_TARGET_PRR
+  #endif
+
+  #define TX_POWER_PRR_UNKNOWN 0xff
+
+  void tx_power_init(void);
+
+  /* Current output power in dBm */
+  int8_t tx_power_dbm(void);
+
+  /* PRR towards the parent over the last window in percent, or TX_POWER_PRR_UNKNOWN */
+  uint8_t tx_power_prr(void);
+#endif
@@ -0,0 +1,372 @@
+/**
+ * \file
+ *         Merges the traces of several border routers into one fleet view
+ *
+ *         Each trace is a slip-capture of one router of a deployment. The
+ *         readings the routers forwarded upstream (record datagrams) are merged in
+ *         wall-clock order, from the start time in each trace header, so the
+ *         captures need not start together. Times are printed in seconds
+ *         since the earliest start. Nodes are told apart by the interface id of
+ *         their address. A sample that reached the host through more than
+ *         one router, or twice through the same one, is recognised by the
+ *         mote's boot number and sample sequence number and counted only
+ *         once. Summaries are made by each router for its own share of a
+ *         node's samples and are passed through as they are.
+ *
+ *         The result is the latest reading of every node with the router
+ *         that owns it, followed by the load each router carried. With -v
+ *         every merged record is printed as well.
+ *
+ *         fleet-merge [-v] trace-file...
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "slip-trace.h"
+
+#define MAX_ROUTERS 8
+/* Size of the node table, a power of two */
+#define MAX_NODES   8192
+
+/* Sequence numbers remembered per boot of a node. It has to cover the backlog
+ * a mote drains after a route loss, a sample older than that counts as new. */
+#define SEQ_WINDOW 1024
+
+struct router {
+  const char *name;
+  FILE *trace;
+  struct trace_record r;
+  uint64_t time_us;     /* wall clock of the current record */
+  int done;
+  unsigned long samples;
+  unsigned long duplicates;
+  unsigned long summaries;
+};
+
+/* Received sequence numbers of one boot, one bit per number modulo
+ * SEQ_WINDOW. Boot 0 is every boot of a mote that sends no boot number. */
+struct seq_window {
+  int valid;
+  uint16_t boot;
+  uint16_t highest;
+  uint8_t seen[SEQ_WINDOW / 8];
+};
+
+struct node {
+  int known;
+  uint8_t iid[RECORD_NODE_IID_LEN];
+  int owner;
+  unsigned long samples;
+  unsigned long duplicates;
+  unsigned long unsequenced;
+  unsigned long handovers;
+  int16_t tempint;
+  uint16_t tempfrac;
+  char minus;
+  uint16_t light;
+  double time;          /* seconds since fleet_start */
+  /* The latest boot and the one before it, whose backlog may still arrive
+   * through another router */
+  struct seq_window seq[2];
+};
+
+static struct router routers[MAX_ROUTERS];
+static int router_count;
+/* The earliest capture start */
+static uint64_t fleet_start;
+static struct node nodes[MAX_NODES];
+static int node_count;
+static unsigned long untracked;
+static int verbose;
+
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: fleet-merge [-v] trace-file...\n");
+  exit(1);
+}
+
+static uint16_t
+get16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+/* Finds the node with the given interface id, adding it if it is new.
+ * Returns NULL when the table is full. */
+static struct node *
+node_lookup(const uint8_t *iid)
+{
+  uint32_t hash = 2166136261u;
+  struct node *n;
+  int i;
+
+  for(i = 0; i < RECORD_NODE_IID_LEN; i++) {
+    hash = (hash ^ iid[i]) * 16777619u;
+  }
+  for(i = 0; i < MAX_NODES; i++) {
+    n = &nodes[(hash + i) & (MAX_NODES - 1)];
+    if(!n->known) {
+      if(node_count == MAX_NODES - 1) {
+        return NULL;
+      }
+      n->known = 1;
+      n->owner = -1;
+      memcpy(n->iid, iid, RECORD_NODE_IID_LEN);
+      node_count++;
+      return n;
+    }
+    if(memcmp(n->iid, iid, RECORD_NODE_IID_LEN) == 0) {
+      return n;
+    }
+  }
+  return NULL;
+}
+
+static int
+seq_test_and_set(struct node *n, uint16_t boot, uint16_t seq)
+{
+  struct seq_window *w;
+  int16_t diff;
+  uint16_t s;
+  int bit;
+
+  if(n->seq[0].valid && n->seq[0].boot == boot) {
+    w = &n->seq[0];
+  } else if(n->seq[1].valid && n->seq[1].boot == boot) {
+    w = &n->seq[1];
+  } else {
+    /* A new boot, the previous one is kept for its backlog */
+    memcpy(&n->seq[1], &n->seq[0], sizeof(struct seq_window));
+    w = &n->seq[0];
+    w->valid = 0;
+  }
+
+  diff = (int16_t)(seq - w->highest);
+  if(!w->valid || diff >= SEQ_WINDOW || diff <= -SEQ_WINDOW) {
+    /* First sample of the boot, or a mote without boot numbers rebooted */
+    memset(w->seen, 0, sizeof(w->seen));
+    w->valid = 1;
+    w->boot = boot;
+    w->highest = seq;
+  } else if(diff > 0) {
+    for(s = w->highest + 1; s != seq; s++) {
+      w->seen[(s % SEQ_WINDOW) / 8] &= ~(1 << (s % 8));
+    }
+    w->seen[(seq % SEQ_WINDOW) / 8] &= ~(1 << (seq % 8));
+    w->highest = seq;
+  }
+
+  bit = w->seen[(seq % SEQ_WINDOW) / 8] & (1 << (seq % 8));
+  w->seen[(seq % SEQ_WINDOW) / 8] |= 1 << (seq % 8);
+  return bit != 0;
+}
+
+/* Formats an interface id the way it appears in the node's address */
+static const char *
+iid_string(const uint8_t *iid)
+{
+  static char buf[20];
+
+  snprintf(buf, sizeof(buf), "%x:%x:%x:%x", (iid[0] << 8) | iid[1], (iid[2] << 8) | iid[3],
+           (iid[4] << 8) | iid[5], (iid[6] << 8) | iid[7]);
+  return buf;
+}
+
+/* Orders the node table by interface id for printing */
+static int
+compare_nodes(const void *a, const void *b)
+{
+  const struct node *na = *(const struct node **)a;
+  const struct node *nb = *(const struct node **)b;
+
+  return memcmp(na->iid, nb->iid, RECORD_NODE_IID_LEN);
+}
+
+static void
+print_temperature(int16_t tempint, uint16_t tempfrac, char minus)
+{
+  printf("%s%d.%04u", minus == '-' && tempint == 0 ? "-" : "", tempint, tempfrac);
+}
+
+static void
+merge_record(int router, const uint8_t *record)
+{
+  struct router *r = &routers[router];
+  struct node *n = node_lookup(&record[RECORD_NODE_IID]);
+  uint16_t seq = get16(&record[RECORD_SAMPLE_SEQ]);
+  uint16_t boot = get16(&record[RECORD_SAMPLE_BOOT]);
+  uint8_t flags = record[RECORD_FLAGS];
+  int duplicate = 0;
+
+  if(n == NULL) {
+    untracked++;
+    return;
+  }
+
+  if(flags & RECORD_FLAG_SUMMARY) {
+    r->summaries++;
+  } else if(!(flags & RECORD_FLAG_SEQUENCED)) {
+    /* Motes without sequence numbers cannot be deduplicated */
+    n->unsequenced++;
+  } else if(seq_test_and_set(n, boot, seq)) {
+    duplicate = 1;
+  }
+
+  if(verbose) {
+    printf("%10.3f %-12s %-19s %5u/%-5u ", (r->time_us - fleet_start) / 1e6, r->name,
+           iid_string(&record[RECORD_NODE_IID]), boot, seq);
+    print_temperature(get16(&record[RECORD_TEMPINT]), get16(&record[RECORD_TEMPFRAC]),
+                      record[RECORD_MINUS]);
+    printf(" %5u%s%s\n", get16(&record[RECORD_LIGHT]),
+           flags & RECORD_FLAG_SUMMARY ? " summary" : "",
+           duplicate ? " duplicate" : "");
+  }
+
+  if(flags & RECORD_FLAG_SUMMARY) {
+    return;
+  }
+  if(duplicate) {
+    r->duplicates++;
+    n->duplicates++;
+    return;
+  }
+
+  r->samples++;
+  n->samples++;
+  if(n->owner >= 0 && n->owner != router) {
+    n->handovers++;
+  }
+  n->owner = router;
+  n->tempint = get16(&record[RECORD_TEMPINT]);
+  n->tempfrac = get16(&record[RECORD_TEMPFRAC]);
+  n->minus = record[RECORD_MINUS];
+  n->light = get16(&record[RECORD_LIGHT]);
+  n->time = (r->time_us - fleet_start) / 1e6;
+}
+
+/* Reads up to the next frame the router sent to the host */
+static void
+advance(struct router *r)
+{
+  int ret;
+
+  while((ret = trace_read_record(r->trace, &r->r)) > 0) {
+    r->time_us += r->r.delta_us;
+    if(r->r.dir == TRACE_FROM_ROUTER) {
+      return;
+    }
+  }
+  if(ret < 0) {
+    fprintf(stderr, "fleet-merge: %s is truncated or corrupt\n", r->name);
+  }
+  r->done = 1;
+}
+
+int
+main(int argc, char **argv)
+{
+  static struct node *sorted[MAX_NODES];
+  struct router *r;
+  const uint8_t *records;
+  unsigned long total;
+  int owned;
+  int next;
+  int opt;
+  int count;
+  int i;
+  int j;
+
+  while((opt = getopt(argc, argv, "v")) != -1) {
+    switch(opt) {
+    case 'v':
+      verbose = 1;
+      break;
+    default:
+      usage();
+    }
+  }
+  if(optind == argc || argc - optind > MAX_ROUTERS) {
+    usage();
+  }
+
+  for(i = optind; i < argc; i++) {
+    r = &routers[router_count++];
+    r->name = strrchr(argv[i], '/') != NULL ? strrchr(argv[i], '/') + 1 : argv[i];
+    r->trace = fopen(argv[i], "rb");
+    if(r->trace == NULL || trace_read_header(r->trace, &r->time_us) < 0) {
+      fprintf(stderr, "fleet-merge: %s is not a trace file\n", argv[i]);
+      return 1;
+    }
+    if(r->time_us == 0) {
+      fprintf(stderr, "fleet-merge: %s has no start time, capture it again\n", argv[i]);
+      return 1;
+    }
+    if(fleet_start == 0 || r->time_us < fleet_start) {
+      fleet_start = r->time_us;
+    }
+    advance(r);
+  }
+
+  for(;;) {
+    next = -1;
+    for(i = 0; i < router_count; i++) {
+      if(!routers[i].done && (next < 0 || routers[i].time_us < routers[next].time_us)) {
+        next = i;
+      }
+    }
+    if(next < 0) {
+      break;
+    }
+    r = &routers[next];
+    records = frame_records(r->r.data, r->r.len, &count);
+    for(i = 0; records != NULL && i < count; i++) {
+      merge_record(next, &records[i * RECORD_LEN]);
+    }
+    advance(r);
+  }
+
+  count = 0;
+  for(i = 0; i < MAX_NODES; i++) {
+    /* Nodes that only sent summaries have no owner */
+    if(nodes[i].known && nodes[i].owner >= 0) {
+      sorted[count++] = &nodes[i];
+    }
+  }
+  qsort(sorted, count, sizeof(sorted[0]), compare_nodes);
+
+  printf("node                router       samples duplicates handovers  last at   temperature light\n");
+  for(i = 0; i < count; i++) {
+    printf("%-19s %-12s %7lu %10lu %9lu %9.1f   ", iid_string(sorted[i]->iid),
+           routers[sorted[i]->owner].name, sorted[i]->samples, sorted[i]->duplicates,
+           sorted[i]->handovers, sorted[i]->time);
+    print_temperature(sorted[i]->tempint, sorted[i]->tempfrac, sorted[i]->minus);
+    printf(" %5u", sorted[i]->light);
+    if(sorted[i]->unsequenced > 0) {
+      printf(" (%lu without sequence number)", sorted[i]->unsequenced);
+    }
+    printf("\n");
+  }
+  if(untracked > 0) {
+    printf("(%lu records of nodes beyond the %d the table holds)\n", untracked, MAX_NODES - 1);
+  }
+
+  total = 0;
+  for(i = 0; i < router_count; i++) {
+    total += routers[i].samples;
+  }
+  printf("\nrouter       samples duplicates summaries nodes share\n");
+  for(i = 0; i < router_count; i++) {
+    owned = 0;
+    for(j = 0; j < count; j++) {
+      owned += sorted[j]->owner == i;
+    }
+    printf("%-12s %7lu %10lu %9lu %5d %4.0f%%\n", routers[i].name,
+           routers[i].samples, routers[i].duplicates, routers[i].summaries, owned,
+           total > 0 ? routers[i].samples * 100.0 / total : 0);
+    fclose(routers[i].trace);
+  }
+  return 0;
+}
@@ -0,0 +1,303 @@
+/**
+ * \file
+ *         Simulates a multi-root deployment and writes the trace each border
+ *         router would have captured
+ *
+ *         Routers sit on a grid and motes are spread at random over the same
+ *         square. Every send period each mote sends a sample to the root it
+ *         currently hears best, which changes as the link quality varies, and
+ *         now and then the sample also reaches the root before or after a
+ *         handover. Motes reboot at random, which restarts their sequence
+ *         numbers under a new boot number. The interface ids of the motes
+ *         share their last byte every 256 motes. The roots start capturing
+ *         up to half a minute apart, before the first sample.
+ *
+ *         The traces hold the record datagrams the routers send upstream and
+ *         can be merged with fleet-merge. fleet-sim prints what the merge
+ *         should find and the load of every root against the SLIP link.
+ *
+ *         fleet-sim [-r routers] [-n motes] [-t seconds] [-p period]
+ *                   [-d duplicate-percent] [-s seed] output-prefix
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "slip-trace.h"
+
+#define MAX_ROUTERS 8
+#define MAX_MOTES   8000
+
+/* Spread of the link quality around the distance to a root */
+#define LINK_NOISE 0.05
+/* One in this many samples follows a reboot of the mote */
+#define REBOOT_ODDS 5000
+
+/* Wall clock of the first sample, 2026-01-01, in microseconds */
+#define SIM_START_US 1767225600000000ULL
+/* The roots start their captures up to this many seconds before it */
+#define CAPTURE_SKEW 30
+
+/* 115200 baud with 8N1 framing */
+#define SLIP_BYTES_PER_SECOND 11520.0
+
+#define HBH_LEN 8
+
+struct root {
+  double x, y;
+  FILE *trace;
+  double last_time;
+  unsigned long samples;
+  unsigned long bytes;
+  int motes;
+};
+
+struct mote {
+  double x, y;
+  double phase;
+  uint8_t iid[RECORD_NODE_IID_LEN];
+  uint16_t boot;
+  uint16_t seq;
+  int owner;
+};
+
+static struct root roots[MAX_ROUTERS];
+static struct mote motes[MAX_MOTES];
+static uint32_t rng_state = 1;
+
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: fleet-sim [-r routers] [-n motes] [-t seconds] [-p period]\n"
+          "                 [-d duplicate-percent] [-s seed] output-prefix\n");
+  exit(1);
+}
+
+/* xorshift32, so that a seed always gives the same deployment */
+static double
+rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state / 4294967296.0;
+}
+
+static double
+gaussian(void)
+{
+  return sqrt(-2 * log(rng() + 1e-12)) * cos(2 * M_PI * rng());
+}
+
+static int
+compare_phase(const void *a, const void *b)
+{
+  const struct mote *ma = a;
+  const struct mote *mb = b;
+
+  return ma->phase < mb->phase ? -1 : ma->phase > mb->phase;
+}
+
+static void
+put16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+
+static void
+put32(uint8_t *p, uint32_t v)
+{
+  put16(p, v & 0xffff);
+  put16(p + 2, v >> 16);
+}
+
+/* Writes the record datagram root r sends for one sample of mote m, laid
+ * out as in rpl-border-router/record-log.h */
+static void
+send_record(struct root *r, const struct mote *m, double time)
+{
+  static struct trace_record t;
+  uint8_t *ip = t.data;
+  uint8_t *udp = &ip[40 + HBH_LEN];
+  uint8_t *record = &udp[8 + RECORD_HDR_LEN];
+  int udp_len = 8 + RECORD_HDR_LEN + RECORD_LEN;
+
+  memset(ip, 0, 40 + HBH_LEN + udp_len);
+  ip[0] = 0x60;
+  ip[4] = (HBH_LEN + udp_len) >> 8;
+  ip[5] = (HBH_LEN + udp_len) & 0xff;
+  ip[6] = 0;                    /* RPL hop-by-hop option */
+  ip[7] = 64;
+  ip[8] = ip[9] = ip[24] = ip[25] = 0xaa;
+  ip[39] = 1;
+  ip[40] = 17;
+  ip[42] = 0x63;
+  ip[43] = 4;
+
+  udp[0] = udp[2] = RECORD_PORT >> 8;
+  udp[1] = udp[3] = RECORD_PORT & 0xff;
+  udp[4] = udp_len >> 8;
+  udp[5] = udp_len & 0xff;
+  udp[8] = 'R';
+  udp[9] = 1;
+
+  put32(&record[0], r->samples + 1);
+  put32(&record[RECORD_TIMESTAMP], (uint32_t)time);
+  put16(&record[RECORD_EPOCH], 1);
+  put16(&record[RECORD_TEMPINT], 20 + m->iid[7] % 5);
+  put16(&record[RECORD_TEMPFRAC], 0);
+  record[RECORD_MINUS] = ' ';
+  put16(&record[RECORD_LIGHT], 100 + m->seq % 50);
+  put16(&record[RECORD_SAMPLE_SEQ], m->seq);
+  put16(&record[RECORD_SAMPLE_BOOT], m->boot);
+  memcpy(&record[RECORD_NODE_IID], m->iid, RECORD_NODE_IID_LEN);
+  record[RECORD_NODE_ID] = m->iid[RECORD_NODE_IID_LEN - 1];
+  record[RECORD_FLAGS] = RECORD_FLAG_SEQUENCED;
+
+  t.len = 40 + HBH_LEN + udp_len;
+  t.dir = TRACE_FROM_ROUTER;
+  t.delta_us = (uint32_t)((time - r->last_time) * 1e6);
+  r->last_time = time;
+  trace_write_record(r->trace, &t);
+
+  r->samples++;
+  /* SLIP adds an END byte on either side */
+  r->bytes += t.len + 2;
+}
+
+/* The root mote m hears best right now, and the runner-up in second */
+static int
+best_root(const struct mote *m, int count, int *second)
+{
+  double quality, best = -1e9, next = -1e9;
+  int i, b = 0;
+
+  *second = -1;
+  for(i = 0; i < count; i++) {
+    quality = -hypot(m->x - roots[i].x, m->y - roots[i].y) + LINK_NOISE * gaussian();
+    if(quality > best) {
+      next = best;
+      *second = b == i ? -1 : b;
+      best = quality;
+      b = i;
+    } else if(quality > next) {
+      next = quality;
+      *second = i;
+    }
+  }
+  return b;
+}
+
+int
+main(int argc, char **argv)
+{
+  char path[256];
+  struct mote *m;
+  unsigned long unique = 0, duplicates = 0, reboots = 0;
+  double seconds = 3600, period = 60, duplicate = 2;
+  double time, load;
+  int router_count = 2, mote_count = 100;
+  int grid, opt, i, k, periods, root, second;
+
+  while((opt = getopt(argc, argv, "r:n:t:p:d:s:")) != -1) {
+    switch(opt) {
+    case 'r':
+      router_count = atoi(optarg);
+      break;
+    case 'n':
+      mote_count = atoi(optarg);
+      break;
+    case 't':
+      seconds = atof(optarg);
+      break;
+    case 'p':
+      period = atof(optarg);
+      break;
+    case 'd':
+      duplicate = atof(optarg);
+      break;
+    case 's':
+      rng_state = strtoul(optarg, NULL, 0) | 1;
+      break;
+    default:
+      usage();
+    }
+  }
+  if(optind != argc - 1 || router_count < 1 || router_count > MAX_ROUTERS ||
+     mote_count < 1 || mote_count > MAX_MOTES || period <= 0) {
+    usage();
+  }
+
+  for(grid = 1; grid * grid < router_count; grid++);
+  for(i = 0; i < router_count; i++) {
+    roots[i].x = (i % grid + 0.5) / grid;
+    roots[i].y = (i / grid + 0.5) / grid;
+    snprintf(path, sizeof(path), "%s%d.bin", argv[optind], i + 1);
+    roots[i].last_time = -rng() * CAPTURE_SKEW;
+    roots[i].trace = fopen(path, "wb");
+    if(roots[i].trace == NULL ||
+       trace_write_header(roots[i].trace, SIM_START_US + (int64_t)(roots[i].last_time * 1e6)) < 0) {
+      perror(path);
+      return 1;
+    }
+  }
+
+  for(i = 0; i < mote_count; i++) {
+    m = &motes[i];
+    m->x = rng();
+    m->y = rng();
+    m->phase = rng() * period;
+    /* Z1 style interface id, the last byte repeats every 256 motes */
+    m->iid[0] = 0x02;
+    m->iid[1] = 0x12;
+    m->iid[2] = 0x74;
+    m->iid[5] = i >> 16;
+    m->iid[6] = (i >> 8) & 0xff;
+    m->iid[7] = i & 0xff;
+    m->boot = 1;
+    m->owner = -1;
+  }
+  qsort(motes, mote_count, sizeof(motes[0]), compare_phase);
+
+  periods = seconds / period;
+  for(k = 0; k < periods; k++) {
+    for(i = 0; i < mote_count; i++) {
+      m = &motes[i];
+      time = k * period + m->phase;
+      if(rng() * REBOOT_ODDS < 1) {
+        m->boot++;
+        m->seq = 0;
+        reboots++;
+      }
+      m->seq++;
+
+      root = best_root(m, router_count, &second);
+      m->owner = root;
+      send_record(&roots[root], m, time);
+      unique++;
+      if(second >= 0 && rng() * 100 < duplicate) {
+        send_record(&roots[second], m, time);
+        duplicates++;
+      }
+    }
+  }
+
+  for(i = 0; i < mote_count; i++) {
+    roots[motes[i].owner].motes++;
+  }
+
+  printf("%d motes, %d roots, %d periods of %.0f s\n", mote_count, router_count, periods, period);
+  printf("expected        %lu samples, %lu duplicates, %lu reboots\n",
+         unique, duplicates, reboots);
+  printf("\nroot  motes records  load of SLIP  motes at full SLIP load\n");
+  for(i = 0; i < router_count; i++) {
+    load = roots[i].bytes / (periods * period) / SLIP_BYTES_PER_SECOND;
+    printf("%4d %6d %7lu %11.2f%% %24.0f\n", i + 1, roots[i].motes, roots[i].samples,
+           load * 100, load > 0 ? roots[i].motes / load : 0);
+    fclose(roots[i].trace);
+  }
+  return 0;
+}
@@ -0,0 +1,206 @@
+/**
+ * \file
+ *         Records the SLIP traffic of a border router to a trace file
+ *
+ *         The tool opens the router's serial line (or a Cooja serial socket)
+ *         and offers a pseudo terminal in its place, so tunslip6 keeps working
+ *         with -s <pty>. Every frame passing in either direction is written
+ *         to the trace with its arrival time.
+ *
+ *         slip-capture [-s device] [-B baud] [-a host -p port] trace-file
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "slip-trace.h"
+
+static volatile sig_atomic_t stop;
+static struct timeval last_frame;
+static unsigned long frames[2][FRAME_TYPES];
+static unsigned long bytes[2];
+
+static void
+on_signal(int sig)
+{
+  stop = 1;
+}
+
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: slip-capture [-s device] [-B baud] [-a host -p port] trace-file\n");
+  exit(1);
+}
+
+static int
+open_pty(void)
+{
+  struct termios tty;
+  int fd;
+
+  fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if(fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+    return -1;
+  }
+  if(tcgetattr(fd, &tty) == 0) {
+    cfmakeraw(&tty);
+    tcsetattr(fd, TCSANOW, &tty);
+  }
+  return fd;
+}
+
+static void
+record_frame(FILE *trace, int dir, const uint8_t *frame, int len)
+{
+  static struct trace_record r;
+  struct timeval now;
+  uint64_t delta;
+
+  gettimeofday(&now, NULL);
+  delta = (uint64_t)(now.tv_sec - last_frame.tv_sec) * 1000000 +
+    (now.tv_usec - last_frame.tv_usec);
+  last_frame = now;
+
+  r.delta_us = delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta;
+  r.len = len;
+  r.dir = dir;
+  memcpy(r.data, frame, len);
+  if(trace_write_record(trace, &r) < 0) {
+    perror("slip-capture: write");
+    stop = 1;
+  }
+
+  frames[dir][frame_classify(frame, len)]++;
+  bytes[dir] += len;
+}
+
+/* Forwards a chunk read from one side to the other and records the frames in it */
+static void
+relay(FILE *trace, struct slip_decoder *d, int dir, const uint8_t *buf, int n, int out)
+{
+  int i;
+  int len;
+
+  if(out >= 0 && write(out, buf, n) < 0 && errno != EIO) {
+    perror("slip-capture: relay");
+  }
+  for(i = 0; i < n; i++) {
+    len = slip_decode(d, buf[i]);
+    if(len > 0) {
+      record_frame(trace, dir, d->buf, len);
+    }
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  static struct slip_decoder from_router, to_router;
+  const char *device = "/dev/ttyUSB0";
+  const char *host = NULL;
+  const char *port = "60001";
+  int baudrate = 115200;
+  uint8_t buf[512];
+  FILE *trace;
+  fd_set rset;
+  int router;
+  int pty;
+  int opt;
+  int n;
+  int t;
+
+  while((opt = getopt(argc, argv, "s:B:a:p:")) != -1) {
+    switch(opt) {
+    case 's':
+      device = optarg;
+      break;
+    case 'B':
+      baudrate = atoi(optarg);
+      break;
+    case 'a':
+      host = optarg;
+      break;
+    case 'p':
+      port = optarg;
+      break;
+    default:
+      usage();
+    }
+  }
+  if(optind != argc - 1) {
+    usage();
+  }
+
+  router = host != NULL ? open_tcp(host, port) : open_serial(device, baudrate);
+  if(router < 0) {
+    perror("slip-capture: router");
+    return 1;
+  }
+  pty = open_pty();
+  if(pty < 0) {
+    perror("slip-capture: pty");
+    return 1;
+  }
+  /* The first record counts from the start written to the header */
+  gettimeofday(&last_frame, NULL);
+  trace = fopen(argv[optind], "wb");
+  if(trace == NULL ||
+     trace_write_header(trace, (uint64_t)last_frame.tv_sec * 1000000 + last_frame.tv_usec) < 0) {
+    perror("slip-capture: trace");
+    return 1;
+  }
+
+  fprintf(stderr, "slip-capture: run tunslip6 -s %s <prefix>\n", ptsname(pty));
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  while(!stop) {
+    FD_ZERO(&rset);
+    FD_SET(router, &rset);
+    FD_SET(pty, &rset);
+    if(select((router > pty ? router : pty) + 1, &rset, NULL, NULL, NULL) < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      perror("slip-capture: select");
+      break;
+    }
+    if(FD_ISSET(router, &rset)) {
+      n = read(router, buf, sizeof(buf));
+      if(n <= 0) {
+        fprintf(stderr, "slip-capture: router closed the connection\n");
+        break;
+      }
+      relay(trace, &from_router, TRACE_FROM_ROUTER, buf, n, pty);
+    }
+    if(FD_ISSET(pty, &rset)) {
+      /* EIO only means that tunslip6 has not opened the pty yet */
+      n = read(pty, buf, sizeof(buf));
+      if(n > 0) {
+        relay(trace, &to_router, TRACE_TO_ROUTER, buf, n, router);
+      } else if(n < 0 && errno == EIO) {
+        usleep(100000);
+      }
+    }
+  }
+
+  fclose(trace);
+
+  for(n = 0; n < 2; n++) {
+    fprintf(stderr, "%s: %lu bytes,", n == TRACE_TO_ROUTER ? "to router" : "from router", bytes[n]);
+    for(t = 0; t < FRAME_TYPES; t++) {
+      fprintf(stderr, " %s %lu", frame_type_name(t), frames[n][t]);
+    }
+    fprintf(stderr, "\n");
+  }
+  return 0;
+}
@@ -0,0 +1,378 @@
+/**
+ * \file
+ *         Replays a SLIP trace into a border router and reports how it coped
+ *
+ *         Frames the host sent to the router are replayed with their original
+ *         timing divided by the speedup, or back to back with -x 0. With -d the
+ *         readings the router forwarded upstream (record datagrams) are turned back
+ *         into mote sample datagrams addressed to the router, so the sensor
+ *         load of the captured deployment reaches handle_sensor_packet() as
+ *         well. With the router's anomaly filter off (sigma=0) each injected
+ *         sample should come back as one forwarded record; the difference is
+ *         reported as drops.
+ *
+ *         slip-replay [-s device] [-B baud] [-a host -p port] [-x speedup]
+ *                     [-d router-address] [-P router-pid] [-w drain-seconds]
+ *                     trace-file
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "slip-trace.h"
+
+/* Mote frame format, see common/common.h */
+#define SENSOR_FRAME_SAMPLE   'S'
+#define SENSOR_ID_TEMPERATURE 1
+#define SENSOR_ID_LIGHT       2
+#define SENSOR_ID_SEQ         7
+
+static int router;
+static struct slip_decoder from_router;
+static unsigned long sent_frames;
+static unsigned long sent_bytes;
+static unsigned long write_drops;
+static unsigned long injected_samples;
+static unsigned long received[FRAME_TYPES];
+static unsigned long received_records;
+
+static struct in6_addr router_address;
+static int synthesize;
+/* Ports of the compressed transport profile, see common/common.h */
+static unsigned mote_port = 0xf0b1;
+static unsigned router_port = 0xf0b0;
+
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: slip-replay [-s device] [-B baud] [-a host -p port] [-x speedup]\n"
+          "                   [-d router-address] [-P router-pid] [-w drain-seconds]\n"
+          "                   [-c mote-port] [-r router-port] trace-file\n");
+  exit(1);
+}
+
+static double
+now_seconds(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* utime + stime of a process in seconds, -1 if unavailable */
+static double
+cpu_seconds(int pid)
+{
+  char path[64];
+  char line[1024];
+  unsigned long utime, stime;
+  FILE *f;
+  char *p;
+
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  f = fopen(path, "r");
+  if(f == NULL) {
+    return -1;
+  }
+  p = fgets(line, sizeof(line), f);
+  fclose(f);
+  if(p == NULL || (p = strrchr(line, ')')) == NULL ||
+     sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+            &utime, &stime) != 2) {
+    return -1;
+  }
+  return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static void
+handle_router_frame(const uint8_t *frame, int len)
+{
+  const uint8_t *records;
+  int count;
+  int i;
+
+  received[frame_classify(frame, len)]++;
+  records = frame_records(frame, len, &count);
+  for(i = 0; records != NULL && i < count; i++) {
+    if(!(records[i * RECORD_LEN + RECORD_FLAGS] & RECORD_FLAG_SUMMARY)) {
+      received_records++;
+    }
+  }
+}
+
+static void
+poll_router(int timeout_ms)
+{
+  struct pollfd pfd;
+  uint8_t buf[512];
+  int n;
+  int i;
+  int len;
+
+  pfd.fd = router;
+  pfd.events = POLLIN;
+  while(poll(&pfd, 1, timeout_ms) > 0) {
+    n = read(router, buf, sizeof(buf));
+    if(n <= 0) {
+      return;
+    }
+    for(i = 0; i < n; i++) {
+      len = slip_decode(&from_router, buf[i]);
+      if(len > 0) {
+        handle_router_frame(from_router.buf, len);
+      }
+    }
+    timeout_ms = 0;
+  }
+}
+
+static void
+send_frame(const uint8_t *frame, int len)
+{
+  static uint8_t out[2 * FRAME_MAX_LEN + 2];
+  int n;
+
+  n = slip_encode(frame, len, out);
+  if(write(router, out, n) != n) {
+    write_drops++;
+    return;
+  }
+  sent_frames++;
+  sent_bytes += n;
+}
+
+static uint16_t
+udp_checksum(const uint8_t *ip, int udp_len)
+{
+  uint32_t sum = udp_len + 17;
+  int i;
+
+  /* Pseudo header addresses, then the UDP header and payload */
+  for(i = 8; i < 40; i += 2) {
+    sum += (ip[i] << 8) | ip[i + 1];
+  }
+  for(i = 0; i < udp_len; i += 2) {
+    sum += (ip[40 + i] << 8) | (i + 1 < udp_len ? ip[40 + i + 1] : 0);
+  }
+  while(sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  sum = ~sum & 0xffff;
+  return sum == 0 ? 0xffff : sum;
+}
+
+/* Builds the datagram a mote would have sent for a forwarded record */
+static void
+inject_sample(const uint8_t *record)
+{
+  uint8_t ip[40 + 8 + 15];
+  uint8_t *payload = &ip[48];
+  int16_t tempint = record[RECORD_TEMPINT] | (record[RECORD_TEMPINT + 1] << 8);
+  uint16_t tempfrac = record[RECORD_TEMPFRAC] | (record[RECORD_TEMPFRAC + 1] << 8);
+  int negative = tempint < 0 || record[RECORD_MINUS] == '-';
+  int sixteenths = abs(tempint) * 16 + tempfrac / 625;
+  int with_seq = (record[RECORD_FLAGS] & RECORD_FLAG_SEQUENCED) != 0;
+  int udp_len = 8 + (with_seq ? 15 : 9);
+  int ip_len = 40 + udp_len;
+  uint16_t sum;
+
+  if(negative) {
+    sixteenths = -sixteenths;
+  }
+
+  memset(ip, 0, 48);
+  ip[0] = 0x60;
+  ip[4] = udp_len >> 8;
+  ip[5] = udp_len & 0xff;
+  ip[6] = 17;
+  ip[7] = 64;
+  /* Source: router prefix with the interface id of the mote */
+  memcpy(&ip[8], &router_address, 8);
+  memcpy(&ip[16], &record[RECORD_NODE_IID], RECORD_NODE_IID_LEN);
+  memcpy(&ip[24], &router_address, 16);
+
+  ip[40] = mote_port >> 8;
+  ip[41] = mote_port & 0xff;
+  ip[42] = router_port >> 8;
+  ip[43] = router_port & 0xff;
+  ip[44] = udp_len >> 8;
+  ip[45] = udp_len & 0xff;
+
+  payload[0] = SENSOR_FRAME_SAMPLE;
+  payload[1] = SENSOR_ID_TEMPERATURE;
+  payload[2] = 2;
+  payload[3] = sixteenths & 0xff;
+  payload[4] = (sixteenths >> 8) & 0xff;
+  payload[5] = SENSOR_ID_LIGHT;
+  payload[6] = 2;
+  payload[7] = record[RECORD_LIGHT];
+  payload[8] = record[RECORD_LIGHT + 1];
+  if(with_seq) {
+    payload[9] = SENSOR_ID_SEQ;
+    payload[10] = 4;
+    payload[11] = record[RECORD_SAMPLE_SEQ];
+    payload[12] = record[RECORD_SAMPLE_SEQ + 1];
+    payload[13] = record[RECORD_SAMPLE_BOOT];
+    payload[14] = record[RECORD_SAMPLE_BOOT + 1];
+  }
+
+  sum = udp_checksum(ip, udp_len);
+  ip[46] = sum >> 8;
+  ip[47] = sum & 0xff;
+
+  send_frame(ip, ip_len);
+  injected_samples++;
+}
+
+static void
+replay_record(const struct trace_record *r)
+{
+  const uint8_t *records;
+  int count;
+  int i;
+
+  if(r->dir == TRACE_TO_ROUTER) {
+    send_frame(r->data, r->len);
+  } else if(synthesize) {
+    records = frame_records(r->data, r->len, &count);
+    for(i = 0; records != NULL && i < count; i++) {
+      if(!(records[i * RECORD_LEN + RECORD_FLAGS] & RECORD_FLAG_SUMMARY)) {
+        inject_sample(&records[i * RECORD_LEN]);
+      }
+    }
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  static struct trace_record r;
+  const char *device = "/dev/ttyUSB0";
+  const char *host = NULL;
+  const char *port = "60001";
+  int baudrate = 115200;
+  double speedup = 1;
+  double drain = 2;
+  double trace_time = 0;
+  uint64_t capture_start;
+  double start, elapsed, wait;
+  double cpu_start = -1, cpu_end = -1;
+  int pid = 0;
+  int opt;
+  int ret;
+  int t;
+  FILE *trace;
+
+  while((opt = getopt(argc, argv, "s:B:a:p:x:d:P:w:c:r:")) != -1) {
+    switch(opt) {
+    case 's':
+      device = optarg;
+      break;
+    case 'B':
+      baudrate = atoi(optarg);
+      break;
+    case 'a':
+      host = optarg;
+      break;
+    case 'p':
+      port = optarg;
+      break;
+    case 'x':
+      speedup = atof(optarg);
+      break;
+    case 'd':
+      if(inet_pton(AF_INET6, optarg, &router_address) != 1) {
+        usage();
+      }
+      synthesize = 1;
+      break;
+    case 'P':
+      pid = atoi(optarg);
+      break;
+    case 'w':
+      drain = atof(optarg);
+      break;
+    case 'c':
+      mote_port = atoi(optarg);
+      break;
+    case 'r':
+      router_port = atoi(optarg);
+      break;
+    default:
+      usage();
+    }
+  }
+  if(optind != argc - 1) {
+    usage();
+  }
+
+  trace = fopen(argv[optind], "rb");
+  if(trace == NULL || trace_read_header(trace, &capture_start) < 0) {
+    fprintf(stderr, "slip-replay: %s is not a trace file\n", argv[optind]);
+    return 1;
+  }
+  router = host != NULL ? open_tcp(host, port) : open_serial(device, baudrate);
+  if(router < 0) {
+    perror("slip-replay: router");
+    return 1;
+  }
+
+  if(pid > 0) {
+    cpu_start = cpu_seconds(pid);
+  }
+  start = now_seconds();
+
+  while((ret = trace_read_record(trace, &r)) > 0) {
+    trace_time += r.delta_us / 1e6;
+    if(speedup > 0) {
+      /* Keep reading the router's output while waiting for the next frame */
+      while((wait = trace_time / speedup - (now_seconds() - start)) > 0) {
+        poll_router(wait > 0.1 ? 100 : (int)(wait * 1000) + 1);
+      }
+    } else {
+      poll_router(0);
+    }
+    replay_record(&r);
+  }
+  if(ret < 0) {
+    fprintf(stderr, "slip-replay: trace is truncated or corrupt\n");
+  }
+
+  elapsed = now_seconds() - start;
+  for(wait = now_seconds() + drain; now_seconds() < wait;) {
+    poll_router(100);
+  }
+  if(pid > 0) {
+    cpu_end = cpu_seconds(pid);
+  }
+
+  printf("trace time      %.3f s, replayed in %.3f s (x%.1f)\n",
+         trace_time, elapsed, elapsed > 0 ? trace_time / elapsed : 0);
+  printf("sent            %lu frames, %lu bytes, %.1f frames/s\n",
+         sent_frames, sent_bytes, elapsed > 0 ? sent_frames / elapsed : 0);
+  printf("write drops     %lu\n", write_drops);
+  printf("received       ");
+  for(t = 0; t < FRAME_TYPES; t++) {
+    printf(" %s %lu", frame_type_name(t), received[t]);
+  }
+  printf("\n");
+  if(synthesize) {
+    printf("samples         %lu injected, %lu forwarded, %ld dropped\n",
+           injected_samples, received_records,
+           (long)injected_samples - (long)received_records);
+  }
+  if(cpu_start >= 0 && cpu_end >= 0) {
+    printf("router cpu      %.3f s, %.1f us per frame\n", cpu_end - cpu_start,
+           sent_frames > 0 ? (cpu_end - cpu_start) * 1e6 / sent_frames : 0);
+  }
+
+  fclose(trace);
+  close(router);
+  return 0;
+}
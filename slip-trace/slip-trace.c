@@ -0,0 +1,282 @@
+/**
+ * \file
+ *         SLIP frame decoding and trace file format
+ */
+
+#include "slip-trace.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+int
+slip_decode(struct slip_decoder *d, uint8_t c)
+{
+  int len;
+
+  if(c == SLIP_END) {
+    len = d->overflow ? 0 : d->len;
+    d->len = 0;
+    d->escaped = 0;
+    d->overflow = 0;
+    return len;
+  }
+
+  if(d->escaped) {
+    d->escaped = 0;
+    if(c == SLIP_ESC_END) {
+      c = SLIP_END;
+    } else if(c == SLIP_ESC_ESC) {
+      c = SLIP_ESC;
+    }
+  } else if(c == SLIP_ESC) {
+    d->escaped = 1;
+    return 0;
+  }
+
+  if(d->len < FRAME_MAX_LEN) {
+    d->buf[d->len++] = c;
+  } else {
+    d->overflow = 1;
+  }
+  return 0;
+}
+
+int
+slip_encode(const uint8_t *frame, int len, uint8_t *out)
+{
+  int i;
+  int n = 0;
+
+  out[n++] = SLIP_END;
+  for(i = 0; i < len; i++) {
+    if(frame[i] == SLIP_END) {
+      out[n++] = SLIP_ESC;
+      out[n++] = SLIP_ESC_END;
+    } else if(frame[i] == SLIP_ESC) {
+      out[n++] = SLIP_ESC;
+      out[n++] = SLIP_ESC_ESC;
+    } else {
+      out[n++] = frame[i];
+    }
+  }
+  out[n++] = SLIP_END;
+  return n;
+}
+
+enum frame_type
+frame_classify(const uint8_t *frame, int len)
+{
+  if(len == 0) {
+    return FRAME_OTHER;
+  }
+  if((frame[0] & 0xf0) == 0x60) {
+    return FRAME_IPV6;
+  }
+  switch(frame[0]) {
+  case '!':
+    return FRAME_CONFIG;
+  case '?':
+    return FRAME_REQUEST;
+  case '\r':
+    return FRAME_DEBUG;
+  }
+  return FRAME_OTHER;
+}
+
+const char *
+frame_type_name(enum frame_type type)
+{
+  static const char *names[] = { "ipv6", "config", "request", "debug", "other" };
+  return type < FRAME_TYPES ? names[type] : "?";
+}
+
+const uint8_t *
+frame_records(const uint8_t *frame, int len, int *count)
+{
+  const uint8_t *payload;
+  int next;
+  int pos;
+
+  if(len < 40 || (frame[0] & 0xf0) != 0x60) {
+    return NULL;
+  }
+  /* Skip the hop-by-hop and destination options RPL may have added */
+  next = frame[6];
+  pos = 40;
+  while((next == 0 || next == 60) && pos + 2 <= len) {
+    next = frame[pos];
+    pos += (frame[pos + 1] + 1) * 8;
+  }
+  if(next != 17 || pos + 8 + RECORD_HDR_LEN > len ||
+     ((frame[pos + 2] << 8) | frame[pos + 3]) != RECORD_PORT) {
+    return NULL;
+  }
+  payload = &frame[pos + 8];
+  if(payload[0] != 'R') {
+    return NULL;
+  }
+
+  /* A truncated frame only yields its complete records */
+  *count = payload[1];
+  if(RECORD_HDR_LEN + *count * RECORD_LEN > len - (pos + 8)) {
+    *count = (len - (pos + 8) - RECORD_HDR_LEN) / RECORD_LEN;
+  }
+  return &payload[RECORD_HDR_LEN];
+}
+
+static void
+put_le(uint8_t *p, uint32_t v, int bytes)
+{
+  int i;
+  for(i = 0; i < bytes; i++) {
+    p[i] = (v >> (8 * i)) & 0xff;
+  }
+}
+
+static uint32_t
+get_le(const uint8_t *p, int bytes)
+{
+  uint32_t v = 0;
+  int i;
+  for(i = bytes - 1; i >= 0; i--) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+int
+trace_write_header(FILE *f, uint64_t start_us)
+{
+  uint8_t hdr[13];
+
+  memcpy(hdr, TRACE_MAGIC, 4);
+  hdr[4] = TRACE_VERSION;
+  put_le(hdr + 5, start_us & 0xffffffff, 4);
+  put_le(hdr + 9, start_us >> 32, 4);
+  return fwrite(hdr, sizeof(hdr), 1, f) == 1 ? 0 : -1;
+}
+
+int
+trace_read_header(FILE *f, uint64_t *start_us)
+{
+  uint8_t hdr[13];
+
+  if(fread(hdr, 5, 1, f) != 1 || memcmp(hdr, TRACE_MAGIC, 4) != 0) {
+    return -1;
+  }
+  if(hdr[4] == 1) {
+    *start_us = 0;
+    return 0;
+  }
+  if(hdr[4] != TRACE_VERSION || fread(hdr + 5, 8, 1, f) != 1) {
+    return -1;
+  }
+  *start_us = get_le(hdr + 5, 4) | (uint64_t)get_le(hdr + 9, 4) << 32;
+  return 0;
+}
+
+int
+trace_write_record(FILE *f, const struct trace_record *r)
+{
+  uint8_t hdr[7];
+
+  put_le(hdr, r->delta_us, 4);
+  put_le(hdr + 4, r->len, 2);
+  hdr[6] = r->dir;
+  if(fwrite(hdr, sizeof(hdr), 1, f) != 1 ||
+     fwrite(r->data, 1, r->len, f) != r->len) {
+    return -1;
+  }
+  return 0;
+}
+
+int
+trace_read_record(FILE *f, struct trace_record *r)
+{
+  uint8_t hdr[7];
+  size_t n;
+
+  n = fread(hdr, 1, sizeof(hdr), f);
+  if(n == 0) {
+    return 0;
+  }
+  if(n != sizeof(hdr)) {
+    return -1;
+  }
+  r->delta_us = get_le(hdr, 4);
+  r->len = get_le(hdr + 4, 2);
+  r->dir = hdr[6];
+  if(r->len > FRAME_MAX_LEN || fread(r->data, 1, r->len, f) != r->len) {
+    return -1;
+  }
+  return 1;
+}
+
+static speed_t
+baud_constant(int baudrate)
+{
+  switch(baudrate) {
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 230400:
+    return B230400;
+  }
+  return B115200;
+}
+
+int
+open_serial(const char *device, int baudrate)
+{
+  struct termios tty;
+  int fd;
+
+  fd = open(device, O_RDWR | O_NOCTTY);
+  if(fd < 0) {
+    return -1;
+  }
+  if(tcgetattr(fd, &tty) == 0) {
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, baud_constant(baudrate));
+    cfsetospeed(&tty, baud_constant(baudrate));
+    tty.c_cflag |= CLOCAL | CREAD;
+    tcsetattr(fd, TCSAFLUSH, &tty);
+  }
+  return fd;
+}
+
+int
+open_tcp(const char *host, const char *port)
+{
+  struct addrinfo hints, *res, *ai;
+  int fd = -1;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if(getaddrinfo(host, port, &hints, &res) != 0) {
+    return -1;
+  }
+  for(ai = res; ai != NULL; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if(fd < 0) {
+      continue;
+    }
+    if(connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd;
+}
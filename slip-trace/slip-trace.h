@@ -0,0 +1,103 @@
+/**
+ * \file
+ *         SLIP frame decoding and trace file format shared by the capture,
+ *         replay and merge tools
+ *
+ *         A trace starts with the 4 byte magic "SLTR", a version byte and
+ *         the wall-clock time the capture started, in microseconds since the
+ *         Unix epoch (64 bit). One record per frame follows: microseconds
+ *         since the previous frame or the start (32 bit), frame length
+ *         (16 bit), direction (8 bit), all little endian, then the unescaped
+ *         frame. Version 1 traces have no start time.
+ */
+
+#ifndef __SLIP_TRACE_H__
+#define __SLIP_TRACE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+#define TRACE_MAGIC   "SLTR"
+#define TRACE_VERSION 2
+
+#define TRACE_TO_ROUTER   0
+#define TRACE_FROM_ROUTER 1
+
+#define FRAME_MAX_LEN 2048
+
+/* Record datagrams of the router, see rpl-border-router/record-log.h */
+#define RECORD_PORT         0xf0b2
+#define RECORD_HDR_LEN      2
+#define RECORD_LEN          34
+#define RECORD_TIMESTAMP    4
+#define RECORD_EPOCH        8
+#define RECORD_TEMPINT      10
+#define RECORD_TEMPFRAC     12
+#define RECORD_MINUS        14
+#define RECORD_LIGHT        16
+#define RECORD_SAMPLE_SEQ   18
+#define RECORD_SAMPLE_BOOT  20
+#define RECORD_NODE_IID     22
+#define RECORD_NODE_IID_LEN 8
+#define RECORD_NODE_ID      30
+#define RECORD_FLAGS        31
+
+/* Summaries are averages made by the router, not samples of a mote */
+#define RECORD_FLAG_SUMMARY   0x04
+/* The sample carried the mote's sequence number */
+#define RECORD_FLAG_SEQUENCED 0x80
+
+/* Finds the records in a frame holding a record datagram. Returns the first
+ * record and stores their number in count, or returns NULL for any other
+ * frame. */
+const uint8_t *frame_records(const uint8_t *frame, int len, int *count);
+
+enum frame_type {
+  FRAME_IPV6,
+  FRAME_CONFIG,     /* '!' */
+  FRAME_REQUEST,    /* '?' */
+  FRAME_DEBUG,      /* '\r' */
+  FRAME_OTHER,
+  FRAME_TYPES
+};
+
+struct slip_decoder {
+  uint8_t buf[FRAME_MAX_LEN];
+  int len;
+  int escaped;
+  int overflow;
+};
+
+struct trace_record {
+  uint32_t delta_us;
+  uint16_t len;
+  uint8_t dir;
+  uint8_t data[FRAME_MAX_LEN];
+};
+
+/* Feeds one byte, returns the frame length when a frame is complete, else 0 */
+int slip_decode(struct slip_decoder *d, uint8_t c);
+
+/* SLIP-encodes a frame into out, which must hold 2 * len + 2 bytes */
+int slip_encode(const uint8_t *frame, int len, uint8_t *out);
+
+enum frame_type frame_classify(const uint8_t *frame, int len);
+const char *frame_type_name(enum frame_type type);
+
+int trace_write_header(FILE *f, uint64_t start_us);
+/* Stores the start time of the capture in start_us, 0 for a version 1 trace */
+int trace_read_header(FILE *f, uint64_t *start_us);
+int trace_write_record(FILE *f, const struct trace_record *r);
+/* Returns 1 on success, 0 at end of file, -1 on a corrupt trace */
+int trace_read_record(FILE *f, struct trace_record *r);
+
+/* Opens a serial device in raw mode or connects to host:port */
+int open_serial(const char *device, int baudrate);
+int open_tcp(const char *host, const char *port);
+
+#endif /* __SLIP_TRACE_H__ */
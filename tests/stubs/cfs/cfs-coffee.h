@@ -0,0 +1,8 @@
+#ifndef __CFS_COFFEE_H__
+#define __CFS_COFFEE_H__
+
+#include "cfs/cfs.h"
+
+int cfs_coffee_reserve(const char *name, cfs_offset_t size);
+
+#endif /* __CFS_COFFEE_H__ */
@@ -0,0 +1,27 @@
+/**
+ * \file
+ *         A single in-memory file behind the CFS calls, fake_cfs_broken makes
+ *         every open fail like a worn out or missing flash
+ */
+
+#ifndef __CFS_H__
+#define __CFS_H__
+
+typedef long cfs_offset_t;
+
+#define CFS_READ   1
+#define CFS_WRITE  2
+#define CFS_APPEND 4
+
+#define CFS_SEEK_SET 0
+
+extern int fake_cfs_broken;
+
+int cfs_open(const char *name, int flags);
+void cfs_close(int fd);
+int cfs_read(int fd, void *buf, unsigned int len);
+int cfs_write(int fd, const void *buf, unsigned int len);
+cfs_offset_t cfs_seek(int fd, cfs_offset_t offset, int whence);
+int cfs_remove(const char *name);
+
+#endif /* __CFS_H__ */
@@ -0,0 +1,30 @@
+/**
+ * \file
+ *         Assertions shared by the host tests
+ *
+ *         A failed CHECK prints the condition with its location and ends the
+ *         test with exit status 1. A test that gets to CHECK_PASSED() prints
+ *         its name and returns 0 from main().
+ */
+
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond) do {                                              \
+    if(!(cond)) {                                                     \
+      fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      exit(1);                                                        \
+    }                                                                 \
+  } while(0)
+
+/* The test's name is its source file without the .c */
+#define CHECK_PASSED() do {                                           \
+    printf("%.*s: ok\n", (int)strlen(__FILE__) - 2, __FILE__);        \
+    return 0;                                                         \
+  } while(0)
+
+#endif /* __CHECK_H__ */
@@ -0,0 +1,40 @@
+/**
+ * \file
+ *         Just enough of Contiki to run mote modules on the host
+ *
+ *         clock_time_t is 16 bit and CLOCK_SECOND 128 as on the Z1. The clock
+ *         only moves when a test sets fake_clock, and ctimers only fire when a
+ *         test calls fake_ctimer_fire(). clock_seconds() adds fake_seconds,
+ *         for uptimes past the 512 s the 16-bit clock covers.
+ */
+
+#ifndef __CONTIKI_H__
+#define __CONTIKI_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef uint16_t clock_time_t;
+#define CLOCK_SECOND 128
+
+extern clock_time_t fake_clock;
+extern unsigned long fake_seconds;
+clock_time_t clock_time(void);
+unsigned long clock_seconds(void);
+
+struct ctimer {
+  clock_time_t start;
+  clock_time_t interval;
+  void (*f)(void *);
+  void *ptr;
+};
+
+void ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr);
+
+/* The last ctimer set, NULL once it fired */
+extern struct ctimer *fake_ctimer;
+
+/* Runs the pending ctimer at time now, which may be past its expiry */
+void fake_ctimer_fire(clock_time_t now);
+
+#endif /* __CONTIKI_H__ */
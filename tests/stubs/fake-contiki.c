@@ -0,0 +1,123 @@
+/**
+ * \file
+ *         Host implementations of the Contiki calls declared in the stubs
+ */
+
+#include <string.h>
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "lib/random.h"
+#include "net/rime/rimeaddr.h"
+
+#define FAKE_FILE_SIZE 16384
+
+clock_time_t fake_clock;
+unsigned long fake_seconds;
+int fake_cfs_broken;
+struct ctimer *fake_ctimer;
+unsigned short fake_random;
+rimeaddr_t rimeaddr_node_addr;
+
+static unsigned char file[FAKE_FILE_SIZE];
+static cfs_offset_t file_len;
+static cfs_offset_t position;
+
+clock_time_t
+clock_time(void)
+{
+  return fake_clock;
+}
+
+unsigned long
+clock_seconds(void)
+{
+  return fake_seconds + fake_clock / CLOCK_SECOND;
+}
+
+void
+ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr)
+{
+  c->start = fake_clock;
+  c->interval = t;
+  c->f = f;
+  c->ptr = ptr;
+  fake_ctimer = c;
+}
+
+void
+fake_ctimer_fire(clock_time_t now)
+{
+  struct ctimer *c = fake_ctimer;
+
+  fake_ctimer = NULL;
+  fake_clock = now;
+  c->f(c->ptr);
+}
+
+unsigned short
+random_rand(void)
+{
+  return fake_random;
+}
+
+int
+cfs_open(const char *name, int flags)
+{
+  if(fake_cfs_broken) {
+    return -1;
+  }
+  position = flags & CFS_APPEND ? file_len : 0;
+  return 0;
+}
+
+void
+cfs_close(int fd)
+{
+}
+
+int
+cfs_read(int fd, void *buf, unsigned int len)
+{
+  if(position + len > file_len) {
+    len = position < file_len ? file_len - position : 0;
+  }
+  memcpy(buf, &file[position], len);
+  position += len;
+  return len;
+}
+
+int
+cfs_write(int fd, const void *buf, unsigned int len)
+{
+  if(position + len > FAKE_FILE_SIZE) {
+    return -1;
+  }
+  memcpy(&file[position], buf, len);
+  position += len;
+  if(position > file_len) {
+    file_len = position;
+  }
+  return len;
+}
+
+cfs_offset_t
+cfs_seek(int fd, cfs_offset_t offset, int whence)
+{
+  position = offset;
+  return offset;
+}
+
+int
+cfs_remove(const char *name)
+{
+  file_len = 0;
+  return 0;
+}
+
+int
+cfs_coffee_reserve(const char *name, cfs_offset_t size)
+{
+  return size <= FAKE_FILE_SIZE ? 0 : -1;
+}
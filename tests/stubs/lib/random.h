@@ -0,0 +1,8 @@
+#ifndef __RANDOM_H__
+#define __RANDOM_H__
+
+/* Returns fake_random, which tests set as they need */
+extern unsigned short fake_random;
+unsigned short random_rand(void);
+
+#endif /* __RANDOM_H__ */
@@ -0,0 +1,7 @@
+#ifndef __NETSTACK_H__
+#define __NETSTACK_H__
+
+/* As in sensor-mote/project-conf.h */
+#define NETSTACK_RDC_CHANNEL_CHECK_RATE 4
+
+#endif /* __NETSTACK_H__ */
@@ -0,0 +1,14 @@
+#ifndef __RIMEADDR_H__
+#define __RIMEADDR_H__
+
+#include <stdint.h>
+
+#define RIMEADDR_SIZE 8
+
+typedef union {
+  unsigned char u8[RIMEADDR_SIZE];
+} rimeaddr_t;
+
+extern rimeaddr_t rimeaddr_node_addr;
+
+#endif /* __RIMEADDR_H__ */
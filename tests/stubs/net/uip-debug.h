@@ -0,0 +1,8 @@
+#ifndef __UIP_DEBUG_H__
+#define __UIP_DEBUG_H__
+
+#define DEBUG_NONE  0
+#define DEBUG_PRINT 1
+#define PRINTF(...)
+
+#endif /* __UIP_DEBUG_H__ */
@@ -0,0 +1,67 @@
+/**
+ * \file
+ *         Checks the anomaly filter's deviation bound across the whole range
+ *         of the configured minimum deviation
+ */
+
+#include "check.h"
+#include "anomaly-filter.h"
+
+#define NODE 3
+
+static int
+anomalous(int16_t temperature, uint16_t light)
+{
+  uint8_t flags;
+
+  anomaly_filter_sample(NODE, temperature, light, &flags);
+  return (flags & ANOMALY_FLAG_ANOMALY) != 0;
+}
+
+/* A minimum deviation above 46340 used to overflow its square, leaving the
+ * bound at the variance of a steady node and flagging any change */
+static void
+test_large_min_dev(void)
+{
+  anomaly_config config;
+  int i;
+
+  anomaly_filter_get_config(&config);
+  config.sigma = 3;
+  config.temp_min_dev = 0xffff;
+  config.temp_max_step = 0xffff;
+  config.light_min_dev = 60000;
+  config.light_max_step = 0xffff;
+  anomaly_filter_set_config(&config);
+
+  for(i = 0; i < 10; i++) {
+    CHECK(!anomalous(320, 100));
+  }
+  CHECK(!anomalous(320 + 800, 100 + 5000));
+}
+
+/* The default bound still flags a jump */
+static void
+test_default_min_dev(void)
+{
+  anomaly_config config;
+  int i;
+
+  anomaly_filter_get_config(&config);
+  config.temp_min_dev = 8;
+  config.light_min_dev = 20;
+  anomaly_filter_set_config(&config);
+
+  for(i = 0; i < 10; i++) {
+    anomalous(320, 100);
+  }
+  CHECK(anomalous(320 + 800, 100));
+}
+
+int
+main(void)
+{
+  test_large_min_dev();
+  test_default_min_dev();
+  CHECK_PASSED();
+}
@@ -0,0 +1,70 @@
+/**
+ * \file
+ *         Checks that samples dated after the router's clock cannot stall the
+ *         rollups and that untracked nodes do not take a slot
+ */
+
+#include "check.h"
+#include "rollup.h"
+
+#define NODE 4
+
+static rollup_bucket current;
+static rollup_bucket previous;
+
+/* A sample claiming a future minute is dropped and later samples still count */
+static void
+test_future_sample(void)
+{
+  fake_seconds = 1000;
+  rollup_add(NODE, 1000, 16 * 20, 100);
+  rollup_add(NODE, 1000 + 3600UL * 24 * 30, 16 * 90, 900);
+
+  CHECK(rollup_get(NODE, ROLLUP_MINUTE, &current, &previous));
+  CHECK(current.start == 960 && current.count == 1 && current.light_max == 100);
+
+  fake_seconds = 1030;
+  rollup_add(NODE, 1030, 16 * 21, 110);
+  CHECK(rollup_get(NODE, ROLLUP_MINUTE, &current, &previous));
+  CHECK(current.start == 1020 && current.count == 1 && current.light_max == 110);
+  CHECK(previous.start == 960 && previous.count == 1);
+
+  CHECK(rollup_get(NODE, ROLLUP_DAY, &current, &previous));
+  CHECK(current.start == 0 && current.count == 2 && current.light_max == 110);
+}
+
+/* What ingest_sample hands over for an age beyond the uptime after it is
+ * clamped, samples dated at boot */
+static void
+test_backlog_at_boot(void)
+{
+  fake_seconds = 90;
+  rollup_add(NODE + 1, 0, 16 * 20, 50);
+  rollup_add(NODE + 1, 90, 16 * 20, 60);
+
+  CHECK(rollup_get(NODE + 1, ROLLUP_MINUTE, &current, &previous));
+  CHECK(current.start == 60 && current.count == 1);
+  CHECK(previous.start == 0 && previous.count == 1);
+}
+
+/* Node id 0 stands for a node beyond the router's node table */
+static void
+test_untracked_node(void)
+{
+  fake_seconds = 200;
+  rollup_add(0, 200, 16 * 20, 70);
+  CHECK(!rollup_get(0, ROLLUP_MINUTE, &current, &previous));
+
+  rollup_add(NODE + 2, 200, 16 * 20, 80);
+  CHECK(rollup_get(NODE + 2, ROLLUP_MINUTE, &current, &previous));
+  CHECK(current.start == 180 && current.count == 1 && current.light_max == 80);
+}
+
+int
+main(void)
+{
+  test_future_sample();
+  test_backlog_at_boot();
+  test_untracked_node();
+  CHECK_PASSED();
+}
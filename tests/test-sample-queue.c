@@ -0,0 +1,109 @@
+/**
+ * \file
+ *         Checks which samples the mote's backlog keeps once it overflows
+ *
+ *         Built with 2 RAM and 4 flash slots, see the Makefile.
+ */
+
+#include "check.h"
+#include "cfs/cfs.h"
+#include "sample-queue.h"
+
+static void
+push(uint8_t n)
+{
+  uint8_t readings[2] = { n, n };
+
+  sample_queue_push(readings, sizeof(readings));
+}
+
+/* Pops the whole queue and checks that it holds first..last in order */
+static void
+expect(uint8_t first, uint8_t last)
+{
+  sample_entry entry;
+  int n;
+
+  for(n = first; n <= last; n++) {
+    CHECK(sample_queue_pop(&entry));
+    CHECK(entry.len == 2);
+    CHECK(entry.readings[0] == n);
+  }
+  CHECK(!sample_queue_pop(&entry));
+  CHECK(sample_queue_length() == 0);
+}
+
+/* Both stores full: the oldest samples, which sit in flash, go */
+static void
+test_overflow_drops_oldest(void)
+{
+  uint8_t n;
+
+  sample_queue_init();
+  for(n = 1; n <= 10; n++) {
+    push(n);
+  }
+  CHECK(sample_queue_length() == 6);
+  CHECK(sample_queue_dropped() == 4);
+  expect(5, 10);
+}
+
+/* The flash ring keeps its order when it wraps after a partial drain */
+static void
+test_wrap_after_partial_drain(void)
+{
+  sample_entry entry;
+  uint8_t n;
+
+  sample_queue_init();
+  for(n = 1; n <= 6; n++) {
+    push(n);
+  }
+  CHECK(sample_queue_pop(&entry) && entry.readings[0] == 1);
+  CHECK(sample_queue_pop(&entry) && entry.readings[0] == 2);
+  for(n = 7; n <= 9; n++) {
+    push(n);
+  }
+  CHECK(sample_queue_dropped() == 1);
+  expect(4, 9);
+}
+
+/* Without flash only the RAM ring is left, and it drops its oldest */
+static void
+test_without_flash(void)
+{
+  uint8_t n;
+
+  sample_queue_init();
+  fake_cfs_broken = 1;
+  for(n = 1; n <= 10; n++) {
+    push(n);
+  }
+  fake_cfs_broken = 0;
+  CHECK(sample_queue_dropped() == 8);
+  expect(9, 10);
+}
+
+/* Ages come from the time a sample was queued */
+static void
+test_age(void)
+{
+  sample_entry entry;
+
+  sample_queue_init();
+  fake_clock = 0;
+  push(1);
+  fake_clock = 30 * CLOCK_SECOND;
+  CHECK(sample_queue_pop(&entry));
+  CHECK(entry.age == 30);
+}
+
+int
+main(void)
+{
+  test_overflow_drops_oldest();
+  test_wrap_after_partial_drain();
+  test_without_flash();
+  test_age();
+  CHECK_PASSED();
+}
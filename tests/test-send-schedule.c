@@ -0,0 +1,105 @@
+/**
+ * \file
+ *         Checks when the send schedule fires, on time and after a late callback
+ */
+
+#include "check.h"
+#include "lib/random.h"
+#include "net/rime/rimeaddr.h"
+#include "send-schedule.h"
+
+#define PERIOD (CLOCK_SECOND * 10)
+#define SLOT   (CLOCK_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+#define NODE   5
+#define JITTER 7
+#define AT     (NODE * SLOT + JITTER)
+
+static int sends;
+
+static void
+send(void *ptr)
+{
+  sends++;
+}
+
+static clock_time_t
+due(void)
+{
+  return fake_ctimer->start + fake_ctimer->interval;
+}
+
+static void
+start(clock_time_t now)
+{
+  rimeaddr_node_addr.u8[RIMEADDR_SIZE - 1] = NODE;
+  fake_random = JITTER;
+  fake_clock = now;
+  sends = 0;
+  send_schedule_start(PERIOD, send);
+}
+
+/* Every send falls into the node's slot of consecutive periods */
+static void
+test_on_time(clock_time_t t0)
+{
+  int i;
+
+  start(t0);
+  CHECK(fake_ctimer != NULL && fake_ctimer->interval == AT);
+  for(i = 0; i < 5; i++) {
+    CHECK(due() == (clock_time_t)(t0 + AT + i * PERIOD));
+    fake_ctimer_fire(due());
+  }
+  CHECK(sends == 5);
+  CHECK(fake_ctimer->interval == PERIOD);
+}
+
+/* A callback 2.5 periods late sends once and then goes back to the node's
+ * slot, skipping the periods it missed instead of sending them back to back */
+static void
+test_late_callback(clock_time_t t0)
+{
+  clock_time_t late;
+  int i;
+
+  start(t0);
+  fake_ctimer_fire(due());
+  late = due() + PERIOD * 5 / 2;
+  fake_ctimer_fire(late);
+  CHECK(sends == 2);
+
+  /* t0 + AT + 1 period, then 2.5 periods late: the next slot is in period 4 */
+  CHECK(fake_ctimer->interval > 0);
+  CHECK(due() == (clock_time_t)(t0 + AT + 4 * PERIOD));
+
+  for(i = 0; i < 3; i++) {
+    fake_ctimer_fire(due());
+    CHECK(fake_ctimer->interval == PERIOD);
+  }
+  CHECK(sends == 5);
+}
+
+/* Late by just over a period, so the next period's slot has passed by a
+ * tick: the next send waits almost a full period rather than firing at once */
+static void
+test_late_past_slot(clock_time_t t0)
+{
+  start(t0);
+  fake_ctimer_fire(due());
+  fake_ctimer_fire(due() + PERIOD + 1);
+  CHECK(fake_ctimer->interval == PERIOD - 1);
+  CHECK(due() == (clock_time_t)(t0 + AT + 3 * PERIOD));
+}
+
+int
+main(void)
+{
+  test_on_time(1000);
+  test_late_callback(1000);
+  test_late_past_slot(1000);
+  /* Again across the wrap of the 16 bit clock */
+  test_on_time(65000);
+  test_late_callback(65000);
+  test_late_past_slot(65000);
+  CHECK_PASSED();
+}